@@ -0,0 +1,221 @@
+#include "AtlasPacker.hpp"
+
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static void check_name(std::string const &name) {
+	if (name.empty() || name.find_first_of(" \t\r\n") != std::string::npos) {
+		throw std::runtime_error("Sprite name '" + name + "' is empty or contains whitespace.");
+	}
+}
+
+void AtlasPacker::add(std::string const &name, glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels) {
+	check_name(name);
+	for (auto const &image : images) {
+		if (image.name == name) throw std::runtime_error("Two sprites are named '" + name + "'.");
+	}
+	if (size.x == 0 || size.y == 0) {
+		throw std::runtime_error("Sprite '" + name + "' is empty.");
+	}
+	if (pixels.size() != size_t(size.x) * size.y) {
+		throw std::runtime_error("Sprite '" + name + "' has the wrong number of pixels for its size.");
+	}
+	images.emplace_back();
+	images.back().name = name;
+	images.back().size = size;
+	images.back().pixels = pixels;
+}
+
+void AtlasPacker::add_png(std::string const &filename) {
+	//name: everything after the last slash, up to the last dot:
+	size_t begin = filename.find_last_of("/\\");
+	begin = (begin == std::string::npos ? 0 : begin + 1);
+	size_t end = filename.find_last_of('.');
+	if (end == std::string::npos || end < begin) end = filename.size();
+
+	glm::uvec2 size;
+	std::vector< glm::u8vec4 > pixels;
+	load_png(filename, &size, &pixels, UpperLeftOrigin);
+	add(filename.substr(begin, end - begin), size, pixels);
+}
+
+bool AtlasPacker::place_skyline(glm::uvec2 const &size, std::vector< glm::uvec2 > const &sizes, std::vector< glm::uvec2 > *positions) {
+	//the skyline is the lower edge of everything placed so far, as a list of (left to right) segments:
+	struct Segment {
+		uint32_t x, y, width;
+	};
+	std::vector< Segment > skyline;
+	skyline.push_back(Segment{0, 0, size.x});
+
+	//tallest (then widest) first:
+	std::vector< uint32_t > order(sizes.size());
+	for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&sizes](uint32_t a, uint32_t b) {
+		if (sizes[a].y != sizes[b].y) return sizes[a].y > sizes[b].y;
+		return sizes[a].x > sizes[b].x;
+	});
+
+	positions->assign(sizes.size(), glm::uvec2(0));
+	for (uint32_t index : order) {
+		glm::uvec2 rect = sizes[index];
+		//try the rectangle's left edge at the start of each segment; keep the spot where its lower edge is highest up:
+		uint32_t best = -1U;
+		uint32_t best_bottom = -1U;
+		uint32_t best_y = 0;
+		for (uint32_t i = 0; i < skyline.size(); ++i) {
+			uint32_t x = skyline[i].x;
+			if (x + rect.x > size.x) break; //(and every later segment starts further right)
+			//it rests on the lowest segment under it:
+			uint32_t y = 0;
+			uint32_t covered = 0;
+			for (uint32_t j = i; covered < rect.x; ++j) {
+				y = std::max(y, skyline[j].y);
+				covered += skyline[j].width;
+			}
+			if (y + rect.y > size.y) continue;
+			if (y + rect.y < best_bottom) {
+				best = i;
+				best_bottom = y + rect.y;
+				best_y = y;
+			}
+		}
+		if (best == -1U) return false;
+
+		uint32_t x = skyline[best].x;
+		(*positions)[index] = glm::uvec2(x, best_y);
+
+		//the rectangle's lower edge replaces the segments it covers:
+		skyline.insert(skyline.begin() + best, Segment{x, best_bottom, rect.x});
+		uint32_t right = x + rect.x;
+		for (uint32_t j = best + 1; j < skyline.size(); ) {
+			if (skyline[j].x >= right) break;
+			uint32_t end = skyline[j].x + skyline[j].width;
+			if (end <= right) {
+				skyline.erase(skyline.begin() + j);
+			} else {
+				skyline[j].width = end - right;
+				skyline[j].x = right;
+				break;
+			}
+		}
+		//merge neighbours at the same height:
+		for (uint32_t j = 0; j + 1 < skyline.size(); ) {
+			if (skyline[j].y == skyline[j+1].y) {
+				skyline[j].width += skyline[j+1].width;
+				skyline.erase(skyline.begin() + j + 1);
+			} else {
+				j += 1;
+			}
+		}
+	}
+	return true;
+}
+
+void AtlasPacker::pack(glm::uvec2 *size_, std::vector< glm::u8vec4 > *pixels, std::vector< AtlasSprite > *sprites) const {
+	//everything to place, plus a white sprite for untextured shapes:
+	std::vector< Image const * > to_place;
+	bool have_white = false;
+	for (auto const &image : images) {
+		to_place.emplace_back(&image);
+		if (image.name == "white") have_white = true;
+	}
+	Image white;
+	if (!have_white) {
+		white.name = "white";
+		white.size = glm::uvec2(1);
+		white.pixels.assign(1, glm::u8vec4(0xff));
+		to_place.emplace_back(&white);
+	}
+
+	std::vector< glm::uvec2 > padded(to_place.size());
+	uint64_t area = 0;
+	uint32_t largest = 1;
+	for (uint32_t i = 0; i < to_place.size(); ++i) {
+		padded[i] = to_place[i]->size + glm::uvec2(2 * padding);
+		area += uint64_t(padded[i].x) * padded[i].y;
+		largest = std::max(largest, std::max(padded[i].x, padded[i].y));
+	}
+
+	//try power-of-two pages (square, or twice as wide as tall) from smallest to largest, until everything fits:
+	auto grow = [](glm::uvec2 *size) {
+		if (size->x == size->y) size->x *= 2;
+		else size->y *= 2;
+	};
+	glm::uvec2 size(1, 1);
+	while (size.x < largest || size.y < largest || uint64_t(size.x) * size.y < area) grow(&size);
+	std::vector< glm::uvec2 > positions;
+	while (true) {
+		if (size.x > max_size || size.y > max_size) {
+			throw std::runtime_error("Sprites don't fit in a " + std::to_string(max_size) + "x" + std::to_string(max_size) + " atlas.");
+		}
+		if (place_skyline(size, padded, &positions)) break;
+		grow(&size);
+	}
+
+	//copy the sprites in, repeating their edges into the padding:
+	*size_ = size;
+	pixels->assign(size_t(size.x) * size.y, glm::u8vec4(0));
+	sprites->clear();
+	for (uint32_t i = 0; i < to_place.size(); ++i) {
+		Image const &image = *to_place[i];
+		glm::uvec2 at = positions[i];
+		for (uint32_t y = 0; y < padded[i].y; ++y) {
+			uint32_t from_y = uint32_t(glm::clamp(int32_t(y) - int32_t(padding), 0, int32_t(image.size.y) - 1));
+			for (uint32_t x = 0; x < padded[i].x; ++x) {
+				uint32_t from_x = uint32_t(glm::clamp(int32_t(x) - int32_t(padding), 0, int32_t(image.size.x) - 1));
+				(*pixels)[size_t(at.y + y) * size.x + (at.x + x)] = image.pixels[size_t(from_y) * image.size.x + from_x];
+			}
+		}
+		sprites->emplace_back();
+		sprites->back().name = image.name;
+		sprites->back().position = at + glm::uvec2(padding);
+		sprites->back().size = image.size;
+	}
+}
+
+void save_atlas(std::string const &png_filename, std::string const &index_filename,
+	glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels, std::vector< AtlasSprite > const &sprites) {
+
+	save_png(png_filename, size, pixels.data(), UpperLeftOrigin);
+
+	std::ofstream index(index_filename, std::ios::binary);
+	index << "size " << size.x << " " << size.y << "\n";
+	for (auto const &sprite : sprites) {
+		index << "sprite " << sprite.name << " " << sprite.position.x << " " << sprite.position.y
+		      << " " << sprite.size.x << " " << sprite.size.y << "\n";
+	}
+	if (!index) throw std::runtime_error("Failed to write atlas index '" + index_filename + "'.");
+}
+
+void load_atlas_index(std::string const &index_filename, glm::uvec2 *size, std::vector< AtlasSprite > *sprites) {
+	std::ifstream index(index_filename, std::ios::binary);
+	if (!index) throw std::runtime_error("Failed to open atlas index '" + index_filename + "'.");
+
+	*size = glm::uvec2(0);
+	sprites->clear();
+	std::string line;
+	uint32_t line_number = 0;
+	while (std::getline(index, line)) {
+		line_number += 1;
+		std::istringstream words(line);
+		std::string type;
+		if (!(words >> type)) continue; //(blank line)
+		if (type == "size" && (words >> size->x >> size->y)) {
+			continue;
+		} else if (type == "sprite") {
+			AtlasSprite sprite;
+			if (words >> sprite.name >> sprite.position.x >> sprite.position.y >> sprite.size.x >> sprite.size.y) {
+				sprites->emplace_back(sprite);
+				continue;
+			}
+		}
+		throw std::runtime_error("Can't read line " + std::to_string(line_number) + " of atlas index '" + index_filename + "'.");
+	}
+	if (size->x == 0 || size->y == 0) {
+		throw std::runtime_error("Atlas index '" + index_filename + "' has no size.");
+	}
+}
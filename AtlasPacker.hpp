@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * AtlasPacker packs many small images ("sprites") into one big image, so a mode can draw all of
+ * its art from one texture -- and so in one draw call (see TextureAtlas.hpp for the drawing side).
+ *
+ * Sprites are placed tallest first with the skyline bottom-left heuristic (each goes wherever its
+ * far edge ends up nearest the top of the page, leftmost on ties) in the smallest power-of-two
+ * page they fit in. Each sprite's edge pixels are repeated into 'padding' pixels around it, so linear
+ * filtering at the sprite's edge doesn't pick up its neighbours.
+ *
+ * A sprite named "white" (solid white) is added if there isn't one already, so untextured,
+ * vertex-colored shapes can be drawn in the same call as everything else.
+ *
+ * Atlases can be packed at startup, or ahead of time with dist/atlas-pack, which saves the
+ * image as a PNG next to a small text index: a "size W H" line, then one "sprite NAME X Y W H"
+ * line per sprite (in pixels, from the upper left of the image, not counting padding).
+ *
+ * Nothing here needs OpenGL; all image data is stored with the upper left pixel first.
+ */
+
+struct AtlasSprite {
+	std::string name; //no whitespace
+	glm::uvec2 position = glm::uvec2(0); //upper left corner in the atlas
+	glm::uvec2 size = glm::uvec2(0);
+};
+
+struct AtlasPacker {
+	//pixels around each sprite filled with copies of its edge:
+	uint32_t padding = 2;
+	//largest page to try (throws if the sprites don't fit):
+	uint32_t max_size = 4096;
+
+	//add an image to pack ('pixels' has size.x * size.y pixels, upper left first):
+	void add(std::string const &name, glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels);
+	//add a PNG file, named after the file (without directory or extension):
+	void add_png(std::string const &filename);
+
+	//pack everything added so far:
+	void pack(glm::uvec2 *size, std::vector< glm::u8vec4 > *pixels, std::vector< AtlasSprite > *sprites) const;
+
+	//----- internals -----
+	struct Image {
+		std::string name;
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > pixels;
+	};
+	std::vector< Image > images;
+
+	//place rectangles of 'sizes' (padding included) in a size.x by size.y page, returning false if they don't all fit:
+	static bool place_skyline(glm::uvec2 const &size, std::vector< glm::uvec2 > const &sizes, std::vector< glm::uvec2 > *positions);
+};
+
+//write/read an atlas as a PNG plus text index (both throw on error):
+void save_atlas(std::string const &png_filename, std::string const &index_filename,
+	glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels, std::vector< AtlasSprite > const &sprites);
+void load_atlas_index(std::string const &index_filename, glm::uvec2 *size, std::vector< AtlasSprite > *sprites);
@@ -0,0 +1,48 @@
+#include "BallGrid.hpp"
+
+void BallGrid::resize(glm::vec2 half_size, float min_cell_size) {
+	cell_size = min_cell_size;
+	origin = -half_size;
+	cells = glm::ivec2(
+		std::max(1, int32_t(std::ceil(2.0f * half_size.x / cell_size))),
+		std::max(1, int32_t(std::ceil(2.0f * half_size.y / cell_size)))
+	);
+	cell_start.assign(cells.x * cells.y + 1, 0);
+	//force the next build() to re-bucket everything:
+	ball_cell.clear();
+	sorted.clear();
+}
+
+void BallGrid::build(size_t count, float const *position_x, float const *position_y) {
+	//find the cell of every ball, noting if anything moved between cells:
+	bool changed = (ball_cell.size() != count);
+	ball_cell.resize(count, -1U);
+	for (size_t i = 0; i < count; ++i) {
+		glm::ivec2 c = cell_coord(position_x[i], position_y[i]);
+		uint32_t cell = uint32_t(c.y * cells.x + c.x);
+		if (cell != ball_cell[i]) {
+			ball_cell[i] = cell;
+			changed = true;
+		}
+	}
+	if (!changed) return;
+
+	//counting sort by cell:
+	std::fill(cell_start.begin(), cell_start.end(), 0);
+	for (uint32_t cell : ball_cell) {
+		cell_start[cell + 1] += 1;
+	}
+	for (size_t c = 1; c < cell_start.size(); ++c) {
+		cell_start[c] += cell_start[c-1];
+	}
+	//(uses cell_start[cell] as a write cursor, which leaves it pointing at the start of the next cell...)
+	sorted.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		sorted[cell_start[ball_cell[i]]++] = uint32_t(i);
+	}
+	//(...so shift everything back by one cell)
+	for (size_t c = cell_start.size() - 1; c > 0; --c) {
+		cell_start[c] = cell_start[c-1];
+	}
+	cell_start[0] = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * BallGrid is a uniform grid over the court used as a collision broadphase.
+ * Balls are bucketed by their center with a counting sort, so finding the balls near
+ * a paddle (or near another ball) only looks at a few cells instead of every ball.
+ *
+ * The buckets are rebuilt from scratch whenever any ball changes cell (which, with many
+ * fast balls, is nearly every step). That's on purpose: the sort is two linear passes,
+ * and moving just the balls that changed cell (per-cell lists with swap-removal) measured
+ * no faster -- finding every ball's cell costs about as much as the sort itself -- while
+ * making for_each_pair() slower to walk.
+ */
+
+struct BallGrid {
+	//cover the rectangle [-half_size, half_size] with square cells of at least 'min_cell_size':
+	// (balls outside the rectangle are kept in the nearest edge cell)
+	void resize(glm::vec2 half_size, float min_cell_size);
+
+	//bucket balls by position (storage is reused between calls; if no ball has
+	// changed cell since the last build, the sort is skipped):
+	void build(size_t count, float const *position_x, float const *position_y);
+
+	//call fn(ball) for every ball whose center lies in a cell overlapping [min, max]:
+	template< typename F >
+	void query(glm::vec2 const &min, glm::vec2 const &max, F const &fn) const;
+
+	//call fn(a, b) once for every pair of balls in the same or adjacent cells:
+	template< typename F >
+	void for_each_pair(F const &fn) const;
+
+	glm::ivec2 cell_coord(float x, float y) const;
+
+	glm::vec2 origin = glm::vec2(0.0f); //lower-left corner of cell (0,0)
+	float cell_size = 1.0f;
+	glm::ivec2 cells = glm::ivec2(0); //number of cells in x and y
+
+	//balls in cell c are sorted[cell_start[c] .. cell_start[c+1]):
+	std::vector< uint32_t > cell_start;
+	std::vector< uint32_t > sorted;
+	//cell each ball was bucketed into:
+	std::vector< uint32_t > ball_cell;
+};
+
+inline glm::ivec2 BallGrid::cell_coord(float x, float y) const {
+	glm::ivec2 c = glm::ivec2(
+		int32_t(std::floor((x - origin.x) / cell_size)),
+		int32_t(std::floor((y - origin.y) / cell_size))
+	);
+	c.x = std::max(0, std::min(cells.x - 1, c.x));
+	c.y = std::max(0, std::min(cells.y - 1, c.y));
+	return c;
+}
+
+template< typename F >
+void BallGrid::query(glm::vec2 const &min, glm::vec2 const &max, F const &fn) const {
+	glm::ivec2 lo = cell_coord(min.x, min.y);
+	glm::ivec2 hi = cell_coord(max.x, max.y);
+	for (int32_t y = lo.y; y <= hi.y; ++y) {
+		for (int32_t x = lo.x; x <= hi.x; ++x) {
+			uint32_t c = uint32_t(y * cells.x + x);
+			for (uint32_t i = cell_start[c]; i < cell_start[c+1]; ++i) {
+				fn(sorted[i]);
+			}
+		}
+	}
+}
+
+template< typename F >
+void BallGrid::for_each_pair(F const &fn) const {
+	//each cell is paired with itself and with the neighbors to its right and above
+	// (the other four neighbors pair with it from their side):
+	static const glm::ivec2 neighbors[4] = {
+		glm::ivec2(1, 0), glm::ivec2(-1, 1), glm::ivec2(0, 1), glm::ivec2(1, 1),
+	};
+	for (int32_t y = 0; y < cells.y; ++y) {
+		for (int32_t x = 0; x < cells.x; ++x) {
+			uint32_t c = uint32_t(y * cells.x + x);
+			for (uint32_t i = cell_start[c]; i < cell_start[c+1]; ++i) {
+				for (uint32_t j = i + 1; j < cell_start[c+1]; ++j) {
+					fn(sorted[i], sorted[j]);
+				}
+				for (auto const &n : neighbors) {
+					int32_t nx = x + n.x;
+					int32_t ny = y + n.y;
+					if (nx < 0 || nx >= cells.x || ny >= cells.y) continue;
+					uint32_t nc = uint32_t(ny * cells.x + nx);
+					for (uint32_t j = cell_start[nc]; j < cell_start[nc+1]; ++j) {
+						fn(sorted[i], sorted[j]);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,206 @@
+#include "FrameCapture.hpp"
+
+#include "gl_errors.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+FrameCapture::FrameCapture(uint32_t readback_count, uint32_t encoder_count) : readbacks(readback_count) {
+	for (uint32_t i = 0; i < readbacks.size(); ++i) {
+		glGenBuffers(1, &readbacks[i].buffer);
+		free_readbacks.emplace_back(i);
+	}
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+
+	for (uint32_t i = 0; i < encoder_count; ++i) {
+		encoders.emplace_back(&FrameCapture::encode_jobs, this);
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	finish();
+
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		stopping = true;
+	}
+	wake_encoder.notify_all();
+	for (auto &encoder : encoders) {
+		encoder.join();
+	}
+
+	for (auto &readback : readbacks) {
+		glDeleteBuffers(1, &readback.buffer);
+		readback.buffer = 0;
+	}
+}
+
+bool FrameCapture::capture(std::string const &filename, glm::uvec2 const &size, GLenum read_buffer, Format format, bool wait) {
+	//make room, if some readback is done already (or if asked to wait for one):
+	if (free_readbacks.empty()) poll();
+	while (free_readbacks.empty()) {
+		if (!wait) return false;
+		if (!reading.empty()) {
+			//(handing the oldest readback to the encoders doesn't free it yet, but it will be, eventually)
+			retire_oldest(true);
+			continue;
+		}
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			job_done.wait(lock, [this](){ return !encoded.empty(); });
+		}
+		free_encoded();
+	}
+
+	uint32_t index = free_readbacks.back();
+	free_readbacks.pop_back();
+	Readback &readback = readbacks[index];
+	readback.filename = filename;
+	readback.size = size;
+	readback.format = format;
+	readback.png_options = png_options;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * sizeof(glm::u8vec4);
+	if (readback.capacity != bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		readback.capacity = bytes;
+	}
+	glReadBuffer(read_buffer);
+	//with a pixel pack buffer bound, glReadPixels copies into it (at offset 0) and returns right away:
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	//(flush so the fence -- and the copy -- actually get going before the next swap)
+	glFlush();
+
+	reading.emplace_back(index);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	return true;
+}
+
+void FrameCapture::poll() {
+	free_encoded();
+	while (!reading.empty() && retire_oldest(false)) { }
+}
+
+void FrameCapture::finish() {
+	while (!reading.empty()) retire_oldest(true);
+
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		job_done.wait(lock, [this](){ return jobs.empty() && encoding == 0; });
+	}
+	free_encoded();
+}
+
+void FrameCapture::free_encoded() {
+	std::vector< uint32_t > done;
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		if (encoded.empty()) return;
+		done.swap(encoded);
+	}
+	for (uint32_t index : done) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[index].buffer);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		free_readbacks.emplace_back(index);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+bool FrameCapture::retire_oldest(bool wait) {
+	uint32_t index = reading.front();
+	Readback &readback = readbacks[index];
+
+	GLenum result = glClientWaitSync(readback.fence, 0, 0);
+	while (wait && result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 /* 1ms */);
+	}
+	if (result == GL_TIMEOUT_EXPIRED) return false;
+	glDeleteSync(readback.fence);
+	readback.fence = 0;
+	reading.pop_front();
+
+	Job job;
+	job.readback = index;
+	job.filename = std::move(readback.filename);
+	job.size = readback.size;
+	job.format = readback.format;
+	job.png_options = readback.png_options;
+
+	//the buffer stays mapped (and out of use) until an encoder is done reading from it:
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	job.mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.capacity, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!job.mapped) {
+		//(shouldn't happen; there's no way to get the pixels without blocking here, so skip this capture)
+		std::cerr << "NOTE: couldn't map readback buffer, so '" << job.filename << "' won't be saved." << std::endl;
+		free_readbacks.emplace_back(index);
+		GL_ERRORS();
+		return true;
+	}
+
+	//(there are never more jobs than readbacks, so this doesn't need to wait for room)
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		jobs.emplace_back(std::move(job));
+	}
+	wake_encoder.notify_one();
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	return true;
+}
+
+void FrameCapture::encode_jobs() {
+	std::vector< glm::u8vec4 > pixels; //(reused between jobs)
+	while (true) {
+		Job job;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake_encoder.wait(lock, [this](){ return stopping || !jobs.empty(); });
+			if (jobs.empty()) break; //(stopping, and nothing left to do)
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			encoding += 1;
+		}
+
+		//hand the readback back (to be unmapped by the render thread) as soon as it has been read:
+		auto release = [this, &job]() {
+			{
+				std::lock_guard< std::mutex > lock(mutex);
+				encoded.emplace_back(job.readback);
+			}
+			job_done.notify_all();
+		};
+
+		size_t count = size_t(job.size.x) * job.size.y;
+		if (job.format == RawRGBA) {
+			std::ofstream out(job.filename, std::ios::binary);
+			out.write(reinterpret_cast< char const * >(job.mapped), count * sizeof(glm::u8vec4));
+			release();
+			if (!out) std::cerr << "Failed to write '" << job.filename << "'." << std::endl;
+		} else {
+			//(the mapping is read-only, and PNG encoding is slow, so copy the pixels out first)
+			pixels.resize(count);
+			std::memcpy(pixels.data(), job.mapped, count * sizeof(glm::u8vec4));
+			release();
+			//the framebuffer's alpha isn't meaningful, so make the image opaque:
+			for (auto &px : pixels) {
+				px.a = 0xff;
+			}
+			save_png(job.filename, job.size, pixels.data(), LowerLeftOrigin, job.png_options);
+		}
+
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			encoding -= 1;
+		}
+		job_done.notify_all();
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GL.hpp"
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+/*
+ * FrameCapture saves what's on screen to files without stalling the render thread.
+ *
+ * capture() starts an asynchronous glReadPixels into a free pixel buffer object and fences it;
+ * poll() (once per frame) maps the readbacks whose fence has passed -- normally a frame or two
+ * later -- and hands the mapped buffer itself to a pool of encoder threads. The encoders copy or
+ * write the pixels straight out of the mapping, and the next poll() unmaps the buffer and frees it
+ * for another capture. So the render thread only pays for starting readbacks and (un)mapping.
+ *
+ * Each capture holds on to its buffer until an encoder is done with it, so the buffers are also
+ * the encoders' queue: when they're all busy, capture() either waits or skips the frame.
+ */
+
+struct FrameCapture {
+	//'readbacks' pixel buffer objects can be in use at once, 'encoders' threads write files:
+	FrameCapture(uint32_t readbacks = 2, uint32_t encoders = 1);
+	//(waits for every capture to be written)
+	~FrameCapture();
+
+	enum Format {
+		PNG, //PNG file
+		RawRGBA, //just the pixels: 4 bytes per pixel, rows bottom to top (much cheaper to write)
+	};
+
+	//how PNG captures are compressed (read when a capture is started):
+	SavePngOptions png_options;
+
+	//start reading 'size' pixels from 'read_buffer' of the current read framebuffer, to be saved to 'filename':
+	// if every readback buffer is still in use, either waits for one ('wait') or
+	// returns false and captures nothing.
+	bool capture(std::string const &filename, glm::uvec2 const &size, GLenum read_buffer, Format format = PNG, bool wait = false);
+
+	//hand readbacks the GPU has finished to the encoders, and free buffers they're done with (call once per frame):
+	void poll();
+
+	//wait for every capture so far to be written:
+	void finish();
+
+	//----- internals -----
+
+	struct Readback {
+		GLuint buffer = 0; //pixel buffer object
+		GLsizeiptr capacity = 0; //bytes allocated for buffer
+		GLsync fence = 0; //passes when the readback is done
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+		Format format = PNG;
+		SavePngOptions png_options;
+	};
+	std::vector< Readback > readbacks;
+	std::vector< uint32_t > free_readbacks; //not in use
+	std::deque< uint32_t > reading; //waiting on their fence, oldest first
+
+	//map the oldest readback and queue it for encoding ('wait' = block until the GPU is done with it):
+	// returns false if it wasn't done and 'wait' was false
+	bool retire_oldest(bool wait);
+
+	//unmap and free the readbacks the encoders are done with:
+	void free_encoded();
+
+	struct Job {
+		uint32_t readback = 0; //index into readbacks
+		void const *mapped = nullptr; //its pixels (size.x * size.y of them)
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+		Format format = PNG;
+		SavePngOptions png_options;
+	};
+
+	std::mutex mutex; //protects everything below
+	std::condition_variable wake_encoder; //a job was queued (or stopping was set)
+	std::condition_variable job_done; //an encoder is done with a readback (or with a whole job)
+	std::deque< Job > jobs; //waiting to be encoded
+	uint32_t encoding = 0; //jobs being encoded right now
+	std::vector< uint32_t > encoded; //readbacks the encoders are done with (still mapped)
+	bool stopping = false;
+
+	std::vector< std::thread > encoders;
+	void encode_jobs();
+};
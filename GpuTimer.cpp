@@ -0,0 +1,41 @@
+#include "GpuTimer.hpp"
+
+#include "gl_errors.hpp"
+
+GpuTimer::GpuTimer() {
+	glGenQueries(Frames * MaxPerFrame, &queries[0][0]);
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+GpuTimer::~GpuTimer() {
+	glDeleteQueries(Frames * MaxPerFrame, &queries[0][0]);
+}
+
+void GpuTimer::begin_frame() {
+	frame = (frame + 1) % Frames;
+
+	//results for queries issued Frames frames ago:
+	for (uint32_t i = 0; i < counts[frame]; ++i) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(queries[frame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break; //(queries finish in order, so the rest won't be ready either)
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[frame][i], GL_QUERY_RESULT, &ns);
+		profiler.record(phases[frame][i], ns * 1e-6f);
+	}
+	counts[frame] = 0;
+}
+
+void GpuTimer::begin(Profiler::Phase phase) {
+	active = (counts[frame] < MaxPerFrame);
+	if (!active) return;
+	phases[frame][counts[frame]] = phase;
+	glBeginQuery(GL_TIME_ELAPSED, queries[frame][counts[frame]]);
+}
+
+void GpuTimer::end() {
+	if (!active) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	counts[frame] += 1;
+	active = false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Profiler.hpp"
+#include "GL.hpp"
+
+#include <cstdint>
+
+/*
+ * GpuTimer measures how long the GPU spends on parts of a frame with GL_TIME_ELAPSED queries.
+ *
+ * Results take a few frames to come back, so each frame's queries come from a pool that is
+ * reused Frames frames later; begin_frame() collects the results of the queries it is about to
+ * reuse and records them in the profiler (so GPU times show up a few frames late).
+ * Results that still aren't ready by then are dropped rather than waited for.
+ *
+ * GL_TIME_ELAPSED queries can't be nested, so timed sections must not overlap.
+ */
+
+struct GpuTimer {
+	GpuTimer();
+	~GpuTimer();
+
+	//collect old results and start a new frame of queries (call before the frame's first begin()):
+	void begin_frame();
+
+	//time GL commands between begin() and end() as 'phase':
+	// (sections past MaxPerFrame in one frame aren't timed)
+	void begin(Profiler::Phase phase);
+	void end();
+
+	//times from its construction to its destruction (use through GPU_PROFILE_SCOPE):
+	struct Scope {
+		Scope(GpuTimer &timer_, Profiler::Phase phase) : timer(timer_) { timer.begin(phase); }
+		~Scope() { timer.end(); }
+		GpuTimer &timer;
+	};
+
+	static constexpr uint32_t Frames = 4; //frames of queries in flight
+	static constexpr uint32_t MaxPerFrame = 8; //timed sections per frame
+
+	GLuint queries[Frames][MaxPerFrame];
+	Profiler::Phase phases[Frames][MaxPerFrame];
+	uint32_t counts[Frames] = { };
+	uint32_t frame = 0; //index into queries[] for the current frame
+	bool active = false; //between begin() and end() of a timed section
+};
+
+#if KILLER_PONG_PROFILE
+#define GPU_PROFILE_SCOPE(TIMER, PHASE) GpuTimer::Scope PROFILE_SCOPE_NAME(__LINE__)(TIMER, Profiler::PHASE)
+#else
+#define GPU_PROFILE_SCOPE(TIMER, PHASE)
+#endif
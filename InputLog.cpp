@@ -0,0 +1,157 @@
+#include "InputLog.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <iterator>
+
+static char const Magic[4] = {'k','p','i','l'};
+static uint32_t const Version = 1;
+
+//every event is stored as its type plus five integers; which fields those are depends on the type:
+struct EventFields {
+	uint32_t type;
+	int32_t v[5];
+};
+static_assert(sizeof(EventFields) == 4 + 4*5, "EventFields should be packed");
+
+static EventFields pack_event(SDL_Event const &evt) {
+	EventFields f;
+	std::memset(&f, 0, sizeof(f));
+	f.type = evt.type;
+	if (evt.type == SDL_MOUSEMOTION) {
+		f.v[0] = int32_t(evt.motion.state);
+		f.v[1] = evt.motion.x;
+		f.v[2] = evt.motion.y;
+		f.v[3] = evt.motion.xrel;
+		f.v[4] = evt.motion.yrel;
+	} else if (evt.type == SDL_MOUSEBUTTONDOWN || evt.type == SDL_MOUSEBUTTONUP) {
+		f.v[0] = evt.button.button;
+		f.v[1] = evt.button.state;
+		f.v[2] = evt.button.clicks;
+		f.v[3] = evt.button.x;
+		f.v[4] = evt.button.y;
+	} else if (evt.type == SDL_MOUSEWHEEL) {
+		f.v[0] = evt.wheel.x;
+		f.v[1] = evt.wheel.y;
+		f.v[2] = int32_t(evt.wheel.direction);
+	} else if (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP) {
+		f.v[0] = int32_t(evt.key.keysym.scancode);
+		f.v[1] = int32_t(evt.key.keysym.sym);
+		f.v[2] = evt.key.keysym.mod;
+		f.v[3] = evt.key.state;
+		f.v[4] = evt.key.repeat;
+	} else if (evt.type == SDL_WINDOWEVENT) {
+		f.v[0] = evt.window.event;
+		f.v[1] = evt.window.data1;
+		f.v[2] = evt.window.data2;
+	}
+	return f;
+}
+
+static SDL_Event unpack_event(EventFields const &f) {
+	SDL_Event evt;
+	std::memset(&evt, 0, sizeof(evt));
+	evt.type = f.type;
+	if (evt.type == SDL_MOUSEMOTION) {
+		evt.motion.state = uint32_t(f.v[0]);
+		evt.motion.x = f.v[1];
+		evt.motion.y = f.v[2];
+		evt.motion.xrel = f.v[3];
+		evt.motion.yrel = f.v[4];
+	} else if (evt.type == SDL_MOUSEBUTTONDOWN || evt.type == SDL_MOUSEBUTTONUP) {
+		evt.button.button = uint8_t(f.v[0]);
+		evt.button.state = uint8_t(f.v[1]);
+		evt.button.clicks = uint8_t(f.v[2]);
+		evt.button.x = f.v[3];
+		evt.button.y = f.v[4];
+	} else if (evt.type == SDL_MOUSEWHEEL) {
+		evt.wheel.x = f.v[0];
+		evt.wheel.y = f.v[1];
+		evt.wheel.direction = uint32_t(f.v[2]);
+	} else if (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP) {
+		evt.key.keysym.scancode = SDL_Scancode(f.v[0]);
+		evt.key.keysym.sym = SDL_Keycode(f.v[1]);
+		evt.key.keysym.mod = uint16_t(f.v[2]);
+		evt.key.state = uint8_t(f.v[3]);
+		evt.key.repeat = uint8_t(f.v[4]);
+	} else if (evt.type == SDL_WINDOWEVENT) {
+		evt.window.event = uint8_t(f.v[0]);
+		evt.window.data1 = f.v[1];
+		evt.window.data2 = f.v[2];
+	}
+	return evt;
+}
+
+//----- recording -----
+
+InputRecorder::InputRecorder(std::string const &filename, uint64_t seed) : out(filename, std::ios::binary) {
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	out.write(Magic, 4);
+	out.write(reinterpret_cast< char const * >(&Version), sizeof(Version));
+	out.write(reinterpret_cast< char const * >(&seed), sizeof(seed));
+}
+
+void InputRecorder::size(glm::uvec2 const &window_size, glm::uvec2 const &drawable_size) {
+	out.put(char(InputReplay::Record::Size));
+	uint32_t sizes[4] = { window_size.x, window_size.y, drawable_size.x, drawable_size.y };
+	out.write(reinterpret_cast< char const * >(sizes), sizeof(sizes));
+}
+
+void InputRecorder::event(SDL_Event const &evt) {
+	out.put(char(InputReplay::Record::Event));
+	EventFields f = pack_event(evt);
+	out.write(reinterpret_cast< char const * >(&f), sizeof(f));
+}
+
+void InputRecorder::frame(float elapsed) {
+	out.put(char(InputReplay::Record::Frame));
+	out.write(reinterpret_cast< char const * >(&elapsed), sizeof(elapsed));
+}
+
+//----- replaying -----
+
+InputReplay::InputReplay(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+	data.assign(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+
+	uint32_t version = 0;
+	if (data.size() < 4 + sizeof(version) + sizeof(seed) || std::memcmp(data.data(), Magic, 4) != 0) {
+		throw std::runtime_error("'" + filename + "' is not an input log.");
+	}
+	std::memcpy(&version, data.data() + 4, sizeof(version));
+	if (version != Version) {
+		throw std::runtime_error("'" + filename + "' is an input log of unsupported version " + std::to_string(version) + ".");
+	}
+	std::memcpy(&seed, data.data() + 4 + sizeof(version), sizeof(seed));
+	at = 4 + sizeof(version) + sizeof(seed);
+}
+
+bool InputReplay::next(Record *record) {
+	//copy 'size' bytes to 'dst', or throw if the log ends first:
+	auto read = [this](void *dst, size_t size) {
+		if (data.size() - at < size) throw std::runtime_error("Input log ends in the middle of a record.");
+		std::memcpy(dst, data.data() + at, size);
+		at += size;
+	};
+
+	if (at >= data.size()) return false;
+	uint8_t type = 0;
+	read(&type, 1);
+	record->type = Record::Type(type);
+	if (type == Record::Size) {
+		uint32_t sizes[4];
+		read(sizes, sizeof(sizes));
+		record->window_size = glm::uvec2(sizes[0], sizes[1]);
+		record->drawable_size = glm::uvec2(sizes[2], sizes[3]);
+	} else if (type == Record::Event) {
+		EventFields f;
+		read(&f, sizeof(f));
+		record->event = unpack_event(f);
+	} else if (type == Record::Frame) {
+		read(&record->elapsed, sizeof(record->elapsed));
+	} else {
+		throw std::runtime_error("Input log has unknown record type " + std::to_string(type) + ".");
+	}
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SDL.h>
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Input logs record what the main loop fed to the current mode -- window sizes, SDL events,
+ * and each frame's elapsed time -- so a session can be replayed later without a human.
+ *
+ * The file is a short header (magic, version, rng seed) followed by records, each one byte
+ * of record type and then a fixed-size payload. Only the event fields modes look at are kept,
+ * so an event takes 25 bytes instead of sizeof(SDL_Event). Values are stored in native
+ * (little-endian on every platform we build for) byte order.
+ */
+
+struct InputRecorder {
+	//start a new log in 'filename' (throws on failure):
+	InputRecorder(std::string const &filename, uint64_t seed);
+
+	//the window was (re)sized; later events and frames use these sizes:
+	void size(glm::uvec2 const &window_size, glm::uvec2 const &drawable_size);
+	//'evt' was passed to handle_event:
+	void event(SDL_Event const &evt);
+	//the frame ended, and 'elapsed' seconds were passed to the update loop:
+	void frame(float elapsed);
+
+	std::ofstream out;
+};
+
+struct InputReplay {
+	//read all of 'filename' into memory (throws on failure):
+	InputReplay(std::string const &filename);
+
+	struct Record {
+		enum Type : uint8_t {
+			Size = 'S',
+			Event = 'E',
+			Frame = 'F',
+		} type;
+		glm::uvec2 window_size = glm::uvec2(0); //for Size records
+		glm::uvec2 drawable_size = glm::uvec2(0); //for Size records
+		SDL_Event event; //for Event records (fields that weren't recorded are zero)
+		float elapsed = 0.0f; //for Frame records
+	};
+	//read the next record; returns false at the end of the log:
+	bool next(Record *record);
+
+	uint64_t seed = 0; //seed the recorded game was started with
+	std::vector< uint8_t > data;
+	size_t at = 0; //read position in data
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "GL.hpp"
+
+//Shader program that draws axis-aligned, textured, color-tinted quads, one per instance:
+// each instance supplies only a center, a radius (half-size) and a color; the quad's four
+// corners are generated in the vertex shader (draw with glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count)).
+struct InstancedQuadProgram {
+	InstancedQuadProgram();
+	~InstancedQuadProgram();
+
+	GLuint program = 0;
+
+	//Attribute (per-instance variable) locations:
+	GLuint Center_vec2 = -1U;
+	GLuint Radius_vec2 = -1U;
+	GLuint Color_vec4 = -1U;
+
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+
+	//Textures:
+	//TEXTURE0 - texture that is stretched over each quad ([0,1]x[0,1] from lower-left to upper-right)
+};
@@ -0,0 +1,539 @@
+#include "KillerPongGame.hpp"
+
+#include "Trace.hpp"
+
+#include <random>
+#include <math.h>
+#include <limits>
+#include <algorithm>
+
+//SSE2 is part of every x86-64 target, so the ball kernels below use it when available:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KILLER_PONG_SSE2
+#include <emmintrin.h>
+#endif
+
+//out-of-line definitions for constants that get bound to references (std::min, emplace_back, ...):
+// (C++14 still needs these; without them, unoptimized builds fail to link)
+constexpr float KillerPongGame::trail_length;
+constexpr float KillerPongGame::ball_speed_max_multiplier;
+
+void KillerPongGame::Trail::push(glm::vec2 position, float time) {
+	if (count < Capacity) {
+		count += 1;
+	} else {
+		head = (head + 1) % Capacity;
+	}
+	samples[(head + count - 1) % Capacity] = glm::vec3(position, time);
+}
+
+bool KillerPongGame::Trail::position_at(float time, glm::vec2 *position) const {
+	if (count < 2 || time < (*this)[0].z || time > newest().z) return false;
+	//find the first sample recorded at or after 'time' (samples are in time order):
+	uint32_t lo = 1, hi = count - 1;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if ((*this)[mid].z < time) lo = mid + 1;
+		else hi = mid;
+	}
+	//interpolate between it and the sample before it:
+	glm::vec3 const &a = (*this)[lo - 1];
+	glm::vec3 const &b = (*this)[lo];
+	float amt = (b.z > a.z ? (time - a.z) / (b.z - a.z) : 1.0f);
+	*position = glm::mix(glm::vec2(a), glm::vec2(b), amt);
+	return true;
+}
+
+void KillerPongGame::Balls::push_back(glm::vec2 pos_, glm::vec2 vel_, float time_) {
+	position_x.emplace_back(pos_.x);
+	position_y.emplace_back(pos_.y);
+	previous_position_x.emplace_back(pos_.x);
+	previous_position_y.emplace_back(pos_.y);
+	velocity_x.emplace_back(vel_.x);
+	velocity_y.emplace_back(vel_.y);
+	age.emplace_back(0.0f);
+	speed_multiplier.emplace_back(1.0f);
+	trail.emplace_back();
+	trail.back().push(pos_, time_ - trail_length);
+	trail.back().push(pos_, time_);
+}
+
+//----- ball kernels -----
+//These work on the raw arrays in KillerPongGame::Balls, four balls at a time when SSE2 is available.
+
+//position += elapsed * velocity * multiplier:
+// (multiplies in the same order as the scalar expression, so results don't depend on which path ran)
+static void integrate_balls(
+	size_t count, float elapsed, float const *multiplier,
+	float const *velocity_x, float const *velocity_y,
+	float *position_x, float *position_y) {
+	size_t i = 0;
+#ifdef KILLER_PONG_SSE2
+	__m128 const dt = _mm_set1_ps(elapsed);
+	for (; i + 4 <= count; i += 4) {
+		__m128 m = _mm_loadu_ps(multiplier + i);
+		_mm_storeu_ps(position_x + i, _mm_add_ps(_mm_loadu_ps(position_x + i), _mm_mul_ps(_mm_mul_ps(dt, _mm_loadu_ps(velocity_x + i)), m)));
+		_mm_storeu_ps(position_y + i, _mm_add_ps(_mm_loadu_ps(position_y + i), _mm_mul_ps(_mm_mul_ps(dt, _mm_loadu_ps(velocity_y + i)), m)));
+	}
+#endif
+	for (; i < count; ++i) {
+		position_x[i] += elapsed * velocity_x[i] * multiplier[i];
+		position_y[i] += elapsed * velocity_y[i] * multiplier[i];
+	}
+}
+
+//values += amount:
+static void add_to_balls(size_t count, float amount, float *values) {
+	size_t i = 0;
+#ifdef KILLER_PONG_SSE2
+	__m128 const amount4 = _mm_set1_ps(amount);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(values + i, _mm_add_ps(_mm_loadu_ps(values + i), amount4));
+	}
+#endif
+	for (; i < count; ++i) {
+		values[i] += amount;
+	}
+}
+
+//values = min(values * factor, cap):
+static void scale_balls_clamped(size_t count, float factor, float cap, float *values) {
+	size_t i = 0;
+#ifdef KILLER_PONG_SSE2
+	__m128 const factor4 = _mm_set1_ps(factor);
+	__m128 const cap4 = _mm_set1_ps(cap);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(values + i, _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(values + i), factor4), cap4));
+	}
+#endif
+	for (; i < count; ++i) {
+		values[i] = std::min(values[i] * factor, cap);
+	}
+}
+
+//max(|values * scale|):
+static float max_abs_scaled(size_t count, float const *values, float const *scale) {
+	size_t i = 0;
+	float result = 0.0f;
+#ifdef KILLER_PONG_SSE2
+	__m128 const sign = _mm_set1_ps(-0.0f);
+	__m128 result4 = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		result4 = _mm_max_ps(result4, _mm_andnot_ps(sign, _mm_mul_ps(_mm_loadu_ps(values + i), _mm_loadu_ps(scale + i))));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, result4);
+	result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+	for (; i < count; ++i) {
+		result = std::max(result, std::abs(values[i] * scale[i]));
+	}
+	return result;
+}
+
+//bounce positions that went past lo or hi back into [lo,hi]:
+// the overshoot is mirrored back across the wall (which is exactly where the ball would be had it
+// bounced at the moment of contact) and the velocity is made to point back into the range.
+static void reflect_balls(size_t count, float lo, float hi, float *position, float *velocity) {
+	size_t i = 0;
+#ifdef KILLER_PONG_SSE2
+	__m128 const lo4 = _mm_set1_ps(lo);
+	__m128 const hi4 = _mm_set1_ps(hi);
+	__m128 const two_lo4 = _mm_set1_ps(2.0f * lo);
+	__m128 const two_hi4 = _mm_set1_ps(2.0f * hi);
+	__m128 const sign = _mm_set1_ps(-0.0f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 p = _mm_loadu_ps(position + i);
+		__m128 v = _mm_loadu_ps(velocity + i);
+		__m128 above = _mm_cmpgt_ps(p, hi4);
+		__m128 below = _mm_cmplt_ps(p, lo4);
+		__m128 outside = _mm_or_ps(above, below);
+		__m128 abs_v = _mm_andnot_ps(sign, v);
+		//above => p = 2hi - p, v = -|v|; below => p = 2lo - p, v = |v|; otherwise unchanged:
+		p = _mm_or_ps(_mm_andnot_ps(outside, p), _mm_or_ps(
+			_mm_and_ps(above, _mm_sub_ps(two_hi4, p)),
+			_mm_and_ps(below, _mm_sub_ps(two_lo4, p))
+		));
+		v = _mm_or_ps(_mm_andnot_ps(outside, v), _mm_or_ps(
+			_mm_and_ps(above, _mm_or_ps(abs_v, sign)),
+			_mm_and_ps(below, abs_v)
+		));
+		//(clamp in case something moved more than the whole width of the range)
+		_mm_storeu_ps(position + i, _mm_min_ps(_mm_max_ps(p, lo4), hi4));
+		_mm_storeu_ps(velocity + i, v);
+	}
+#endif
+	for (; i < count; ++i) {
+		if (position[i] > hi) {
+			position[i] = 2.0f * hi - position[i];
+			velocity[i] = -std::abs(velocity[i]);
+		} else if (position[i] < lo) {
+			position[i] = 2.0f * lo - position[i];
+			velocity[i] = std::abs(velocity[i]);
+		}
+		position[i] = std::min(std::max(position[i], lo), hi);
+	}
+}
+
+void KillerPongGame::update_ball_speeds(float elapsed) {
+	add_to_balls(balls.size(), elapsed, balls.age.data());
+
+	//every ball's multiplier grows by the same factor this step, so only one pow() is needed:
+	float factor = std::pow((1 + ball_speed_inc_ratio), (elapsed / ball_speed_inc_interval));
+	scale_balls_clamped(balls.size() - balls.saturated, factor, ball_speed_max_multiplier, balls.speed_multiplier.data() + balls.saturated);
+
+	//older balls always have larger multipliers, so newly-capped balls extend the saturated prefix:
+	while (balls.saturated < balls.size() && balls.speed_multiplier[balls.saturated] >= ball_speed_max_multiplier) {
+		balls.saturated += 1;
+	}
+}
+
+bool KillerPongGame::is_complete() const {
+	return left_hp <= 0 || right_hp <= 0;
+}
+
+void KillerPongGame::resize_grid() {
+	//cells are at least one ball across (so overlapping balls are always in the same or adjacent cells)
+	// and otherwise sized to hold about one ball each:
+	float min_cell_size = 2.0f * std::max(ball_radius.x, ball_radius.y);
+	float cell_size = std::max(min_cell_size, std::sqrt(4.0f * court_radius.x * court_radius.y / std::max< size_t >(1, balls.size())));
+	//(only resize when the ideal size has drifted by 2x, since resizing forces a full rebuild)
+	if (grid.origin != -court_radius || grid.cell_size < min_cell_size
+	 || grid.cell_size > 2.0f * cell_size || 2.0f * grid.cell_size < cell_size) {
+		grid.resize(court_radius, cell_size);
+	}
+}
+
+void KillerPongGame::sweep_ball(uint32_t ball, float elapsed) {
+	float &position_x = balls.position_x[ball];
+	float &position_y = balls.position_y[ball];
+	float &velocity_x = balls.velocity_x[ball];
+	float &velocity_y = balls.velocity_y[ball];
+	float multiplier = balls.speed_multiplier[ball];
+
+	struct Paddle {
+		glm::vec2 const &center;
+		uint32_t &hp;
+		float &invincible_elapsed;
+	};
+	Paddle paddles[2] = {
+		{ left_paddle, left_hp, left_invincible_elapsed },
+		{ right_paddle, right_hp, right_invincible_elapsed },
+	};
+
+	//ball centers touch a paddle when they are within 'reach' of its center, and a wall when they are 'wall' from the court center:
+	glm::vec2 reach = paddle_radius + ball_radius;
+	glm::vec2 wall = court_radius - ball_radius;
+
+	auto hit = [this](Paddle &paddle) {
+		if(paddle.invincible_elapsed >= invincible_sec) {
+			// this paddle hit by a ball and not in invisible time, reduce 1 hp
+			paddle.hp--;
+			paddle.invincible_elapsed = 0;
+		}
+	};
+
+	//bounce off a paddle face perpendicular to 'axis':
+	auto bounce = [&](Paddle &paddle, int axis) {
+		if (axis == 1) {
+			//hit top or bottom => bounce in y direction:
+			velocity_y = (position_y > paddle.center.y ? 1.0f : -1.0f) * std::abs(velocity_y);
+		} else {
+			//hit left or right => bounce in x direction:
+			velocity_x = (position_x > paddle.center.x ? 1.0f : -1.0f) * std::abs(velocity_x);
+			//warp y velocity based on offset from paddle center:
+			float vel = (position_y - paddle.center.y) / reach.y;
+			velocity_y = glm::mix(velocity_y, vel, 0.75f);
+		}
+	};
+
+	//if a paddle moved onto the ball since the last step, push the ball out the way it is least deep:
+	for (Paddle &paddle : paddles) {
+		//compute area of overlap:
+		glm::vec2 min = glm::max(paddle.center - paddle_radius, glm::vec2(position_x, position_y) - ball_radius);
+		glm::vec2 max = glm::min(paddle.center + paddle_radius, glm::vec2(position_x, position_y) + ball_radius);
+
+		//if no overlap (just touching doesn't count), no collision:
+		if (min.x >= max.x || min.y >= max.y) continue;
+
+		hit(paddle);
+		if (max.x - min.x > max.y - min.y) {
+			//wider overlap in x => push out in y direction:
+			position_y = paddle.center.y + (position_y > paddle.center.y ? 1.0f : -1.0f) * reach.y;
+			bounce(paddle, 1);
+		} else {
+			//wider overlap in y => push out in x direction:
+			position_x = paddle.center.x + (position_x > paddle.center.x ? 1.0f : -1.0f) * reach.x;
+			bounce(paddle, 0);
+		}
+	}
+
+	//move the ball from contact to contact:
+	float remaining = elapsed;
+	for (uint32_t bounces = 0; bounces < max_bounces && remaining > 0.0f; ++bounces) {
+		glm::vec2 position = glm::vec2(position_x, position_y);
+		glm::vec2 step = (remaining * multiplier) * glm::vec2(velocity_x, velocity_y);
+
+		//find the first contact along position + t * step, t in [0,1]:
+		float first_t = 1.0f;
+		int first_axis = -1;
+		Paddle *first_paddle = nullptr;
+
+		//walls:
+		for (int axis = 0; axis < 2; ++axis) {
+			float t = 2.0f;
+			if (step[axis] > 0.0f && position[axis] + step[axis] > wall[axis]) {
+				t = (wall[axis] - position[axis]) / step[axis];
+			} else if (step[axis] < 0.0f && position[axis] + step[axis] < -wall[axis]) {
+				t = (-wall[axis] - position[axis]) / step[axis];
+			}
+			//(balls already past a wall bounce immediately)
+			t = std::max(t, 0.0f);
+			if (t < first_t) {
+				first_t = t;
+				first_axis = axis;
+				first_paddle = nullptr;
+			}
+		}
+
+		//paddles (ray vs. paddle box grown by the ball's radius, one slab per axis):
+		for (Paddle &paddle : paddles) {
+			float enter = -std::numeric_limits< float >::infinity();
+			float exit = std::numeric_limits< float >::infinity();
+			int enter_axis = -1;
+			for (int axis = 0; axis < 2; ++axis) {
+				float lo = paddle.center[axis] - reach[axis];
+				float hi = paddle.center[axis] + reach[axis];
+				if (step[axis] == 0.0f) {
+					//not moving on this axis, so either always or never inside this slab:
+					if (position[axis] <= lo || position[axis] >= hi) exit = -1.0f;
+					continue;
+				}
+				float t0 = (lo - position[axis]) / step[axis];
+				float t1 = (hi - position[axis]) / step[axis];
+				if (t0 > t1) std::swap(t0, t1);
+				if (t0 > enter) {
+					enter = t0;
+					enter_axis = axis;
+				}
+				exit = std::min(exit, t1);
+			}
+			if (enter_axis >= 0 && enter >= 0.0f && enter < exit && enter < first_t) {
+				first_t = enter;
+				first_axis = enter_axis;
+				first_paddle = &paddle;
+			}
+		}
+
+		//advance to the contact (or all the way, if there wasn't one):
+		position_x += first_t * step.x;
+		position_y += first_t * step.y;
+		remaining *= (1.0f - first_t);
+		if (first_axis < 0) break;
+
+		if (first_paddle) {
+			hit(*first_paddle);
+			bounce(*first_paddle, first_axis);
+		} else {
+			//bounce off the wall:
+			float &velocity = (first_axis == 0 ? velocity_x : velocity_y);
+			float side = (first_axis == 0 ? position_x : position_y);
+			velocity = (side > 0.0f ? -1.0f : 1.0f) * std::abs(velocity);
+		}
+	}
+
+	//if we ran out of bounces, at least make sure the ball stays on the court:
+	position_x = std::min(std::max(position_x, -wall.x), wall.x);
+	position_y = std::min(std::max(position_y, -wall.y), wall.y);
+}
+
+void KillerPongGame::update_ai(glm::vec2 &paddle, int &moving_direction, float elapsed) {
+	// logic: find the nearest in-coming ball, move away from this ball
+	// traverse all balls to find the nearest in-coming one
+	// (a ball is in-coming if it moves towards the paddle's side of the court)
+	size_t nearest = balls.size();
+	float min_distance = std::numeric_limits<float>::max();
+	for (size_t i = 0; i < balls.size(); ++i) {
+		float off_x = balls.position_x[i] - paddle.x;
+		float off_y = balls.position_y[i] - paddle.y;
+		float distance = off_x * off_x + off_y * off_y;
+		if(balls.velocity_x[i] * paddle.x > 0 && distance < min_distance) {
+			nearest = i;
+			min_distance = distance;
+		}
+	}
+
+	if(nearest < balls.size()) {
+		float hit_position_y = balls.position_y[nearest] + (paddle.x - balls.position_x[nearest]) * balls.velocity_y[nearest] / balls.velocity_x[nearest];
+		if (hit_position_y > paddle.y - paddle_radius.y - ball_radius.y * 8 &&
+			hit_position_y < paddle.y + paddle_radius.y + ball_radius.y * 8) {
+			// will be hit by the ball
+			if(moving_direction != 0) {
+				// keep moving in original direction
+				paddle.y += moving_direction * elapsed * ai_speed_factor;
+				if(paddle.y + paddle_radius.y + 0.1 >= court_radius.y) {
+					// hit upper wall, can only moving down
+					moving_direction = -1;
+				} else if(paddle.y - paddle_radius.y - 0.1 <= - court_radius.y) {
+					// hit lower wall, can only moving up
+					moving_direction = 1;
+				}
+			} else {
+				// starts to randomly move up or down
+				moving_direction = rng.unit() >= 0.5f ? 1 : -1;
+			}
+		} else {
+			// clear moving flag
+			moving_direction = 0;
+		}
+	}
+}
+
+void KillerPongGame::update(float elapsed) {
+	//remember where everything was, so drawing can interpolate through this step:
+	previous_left_paddle = left_paddle;
+	previous_right_paddle = right_paddle;
+	balls.previous_position_x = balls.position_x;
+	balls.previous_position_y = balls.position_y;
+
+	if(is_complete()) {
+		// either player does not have a hp left. do not update the game
+		return;
+	}
+
+	time += elapsed;
+
+	//----- paddle update -----
+
+	if (left_ai) {
+		update_ai(left_paddle, left_ai_moving_direction, elapsed);
+	}
+	update_ai(right_paddle, right_ai_moving_direction, elapsed);
+
+	//clamp paddles to court:
+	right_paddle.y = std::max(right_paddle.y, -court_radius.y + paddle_radius.y);
+	right_paddle.y = std::min(right_paddle.y,  court_radius.y - paddle_radius.y);
+
+	left_paddle.y = std::max(left_paddle.y, -court_radius.y + paddle_radius.y);
+	left_paddle.y = std::min(left_paddle.y,  court_radius.y - paddle_radius.y);
+
+	//----- ball update -----
+	// update age & speed of each ball
+	update_ball_speeds(elapsed);
+
+	left_invincible_elapsed += elapsed;
+	right_invincible_elapsed += elapsed;
+
+	// the last ball is the latest ball, check its age to see if we need to create a new one
+	// (a new ball sits still at the center for its first step, so only the balls before it move below)
+	size_t moving = balls.size();
+	if (balls.size() == 0 || balls.age.back() >= ball_create_interval) {
+		float init_vel_x = rng.unit() * 2 - 1; // [-1, 1)
+		float init_vel_y = rng.unit() * 2 - 1; // [-1, 1)
+		// make sure x^2 + y^2 = 1
+		init_vel_x = std::sqrt(init_vel_x * init_vel_x / (init_vel_x * init_vel_x + init_vel_y * init_vel_y)) * (init_vel_x > 0 ? 1 : -1);
+		init_vel_y = std::sqrt(init_vel_y * init_vel_y / (init_vel_x * init_vel_x + init_vel_y * init_vel_y)) * (init_vel_y > 0 ? 1 : -1);
+		balls.push_back(glm::vec2(0.0f, 0.0f), glm::vec2(init_vel_x, init_vel_y), time);
+	}
+
+	TRACE_BEGIN("collisions");
+
+	//balls that might reach a paddle during this step are swept exactly (below), so find them first:
+	// (no ball can move further this step than max_step along each axis)
+	resize_grid();
+	grid.build(balls.size(), balls.position_x.data(), balls.position_y.data());
+	{
+		glm::vec2 max_step = elapsed * glm::vec2(
+			max_abs_scaled(moving, balls.velocity_x.data(), balls.speed_multiplier.data()),
+			max_abs_scaled(moving, balls.velocity_y.data(), balls.speed_multiplier.data())
+		);
+		glm::vec2 reach = paddle_radius + ball_radius + max_step;
+		swept.clear();
+		auto add_swept = [this](uint32_t ball) { swept.emplace_back(ball); };
+		grid.query(left_paddle - reach, left_paddle + reach, add_swept);
+		grid.query(right_paddle - reach, right_paddle + reach, add_swept);
+		std::sort(swept.begin(), swept.end());
+		swept.erase(std::unique(swept.begin(), swept.end()), swept.end());
+
+		swept_velocity.clear();
+		for (uint32_t ball : swept) {
+			swept_velocity.emplace_back(balls.velocity(ball));
+		}
+	}
+
+	//move every ball, bouncing off the court walls:
+	integrate_balls(moving, elapsed, balls.speed_multiplier.data(),
+		balls.velocity_x.data(), balls.velocity_y.data(),
+		balls.position_x.data(), balls.position_y.data());
+	reflect_balls(moving, -court_radius.x + ball_radius.x, court_radius.x - ball_radius.x, balls.position_x.data(), balls.velocity_x.data());
+	reflect_balls(moving, -court_radius.y + ball_radius.y, court_radius.y - ball_radius.y, balls.position_y.data(), balls.velocity_y.data());
+
+	//...then redo the balls near paddles, stopping at each contact:
+	for (size_t i = 0; i < swept.size(); ++i) {
+		uint32_t ball = swept[i];
+		balls.position_x[ball] = balls.previous_position_x[ball];
+		balls.position_y[ball] = balls.previous_position_y[ball];
+		balls.velocity_x[ball] = swept_velocity[i].x;
+		balls.velocity_y[ball] = swept_velocity[i].y;
+		sweep_ball(ball, elapsed);
+	}
+
+	TRACE_END("collisions");
+
+	//---- ball vs ball collision handling ----
+	if (ball_collisions) {
+		TRACE_SCOPE("ball collisions");
+		resize_grid();
+		grid.build(balls.size(), balls.position_x.data(), balls.position_y.data());
+
+		auto ball_vs_ball = [this](uint32_t a, uint32_t b) {
+			//compute area of overlap (both balls are the same size):
+			float dx = balls.position_x[b] - balls.position_x[a];
+			float dy = balls.position_y[b] - balls.position_y[a];
+			float overlap_x = 2.0f * ball_radius.x - std::abs(dx);
+			float overlap_y = 2.0f * ball_radius.y - std::abs(dy);
+
+			//if no overlap, no collision:
+			if (overlap_x <= 0.0f || overlap_y <= 0.0f) {
+				return;
+			}
+
+			//push the balls apart along the axis of least overlap and, if they are approaching
+			// along that axis, exchange those velocity components (an elastic bounce between equal masses):
+			// (balls move at velocity * speed_multiplier, so it's those actual velocities that get exchanged,
+			//  each stored back relative to the multiplier of the ball receiving it)
+			auto bounce = [&](std::vector< float > &position, std::vector< float > &velocity, float d, float overlap) {
+				float dir = (d >= 0.0f ? 1.0f : -1.0f);
+				position[a] -= 0.5f * overlap * dir;
+				position[b] += 0.5f * overlap * dir;
+				float actual_a = velocity[a] * balls.speed_multiplier[a];
+				float actual_b = velocity[b] * balls.speed_multiplier[b];
+				if ((actual_b - actual_a) * dir < 0.0f) {
+					velocity[a] = actual_b / balls.speed_multiplier[a];
+					velocity[b] = actual_a / balls.speed_multiplier[b];
+				}
+			};
+			if (overlap_x < overlap_y) {
+				bounce(balls.position_x, balls.velocity_x, dx, overlap_x);
+			} else {
+				bounce(balls.position_y, balls.velocity_y, dy, overlap_y);
+			}
+		};
+		grid.for_each_pair(ball_vs_ball);
+
+		//(pushing balls apart may have pushed some past the walls)
+		reflect_balls(balls.size(), -court_radius.x + ball_radius.x, court_radius.x - ball_radius.x, balls.position_x.data(), balls.velocity_x.data());
+		reflect_balls(balls.size(), -court_radius.y + ball_radius.y, court_radius.y - ball_radius.y, balls.position_y.data(), balls.velocity_y.data());
+	}
+
+	//----- rainbow trails -----
+	//record each ball's position the first time this update lands in a new sample interval:
+	// (samples are stamped with the game time, so old samples never need to be touched again)
+	float slot = std::floor(time / trail_sample_interval);
+	for (size_t i = 0; i < balls.size(); ++i) {
+		Trail &trail = balls.trail[i];
+		if (std::floor(trail.newest().z / trail_sample_interval) != slot) {
+			trail.push(balls.position(i), time);
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "BallGrid.hpp"
+#include "Xoshiro128.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * KillerPongGame holds the state of a game of Killer Pong and steps it forward in time.
+ * It does not touch SDL or OpenGL, so it can be simulated without a window (see pong_headless.cpp).
+ */
+
+struct KillerPongGame {
+	//advance the simulation by 'elapsed' seconds:
+	void update(float elapsed);
+	bool is_complete() const;
+
+	//----- game state -----
+	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
+	glm::vec2 paddle_radius = glm::vec2(0.2f, 1.0f);
+	glm::vec2 ball_radius = glm::vec2(0.2f, 0.2f);
+
+	glm::vec2 left_paddle = glm::vec2(-court_radius.x + 0.5f, 0.0f);
+	glm::vec2 right_paddle = glm::vec2( court_radius.x - 0.5f, 0.0f);
+	// paddle positions at the start of the last update (for interpolated drawing):
+	glm::vec2 previous_left_paddle = left_paddle;
+	glm::vec2 previous_right_paddle = right_paddle;
+
+	// initially every one has 15 hps, if got hit by the ball, reduce 1 hp
+	uint32_t init_hp = 15;
+	uint32_t left_hp = init_hp;
+	uint32_t right_hp = init_hp;
+	// when losing 1 hp, there are invincible_sec seconds for invincible
+	float invincible_sec = 1.0f;
+	float left_invincible_elapsed = 1.0f;
+	float right_invincible_elapsed = 1.0f;
+
+	// how fast can this ai move (the larger the harder to beat the ai)
+	float ai_speed_factor = 7.0f;
+	// 1: currently moving up, -1: moving down, 0: not moving
+	int left_ai_moving_direction = 0;
+	int right_ai_moving_direction = 0;
+	// the right paddle is always ai-controlled; the left one is the player's unless left_ai is set
+	bool left_ai = false;
+
+	// time length (in seconds) of the ball trail
+	static constexpr float trail_length = 0.1f;
+	// the trail records at most one position per trail_sample_interval seconds:
+	static constexpr float trail_sample_interval = trail_length / 24.0f;
+
+	// Recent positions of a ball (for drawing its trail), kept in a fixed-size ring buffer:
+	struct Trail {
+		// enough samples to cover trail_length at one sample per trail_sample_interval, plus some slack:
+		static constexpr uint32_t Capacity = 32;
+		// record a position; once full, this overwrites the oldest sample:
+		void push(glm::vec2 position, float time);
+		// i-th oldest sample, as (x, y, time it was recorded):
+		glm::vec3 const &operator[](uint32_t i) const { return samples[(head + i) % Capacity]; }
+		glm::vec3 const &newest() const { return (*this)[count - 1]; }
+		// position at 'time', interpolated between the samples around it (found by binary search);
+		// returns false if 'time' is outside the recorded samples:
+		bool position_at(float time, glm::vec2 *position) const;
+
+		glm::vec3 samples[Capacity];
+		uint32_t head = 0; //index of the oldest sample
+		uint32_t count = 0;
+	};
+	// create a new ball every 5 secs
+	static constexpr float ball_create_interval = 5.0f;
+
+	// increase speed of each ball by ball_speed_inc_ratio (%) every ball_speed_inc_interval (s) seconds
+	static constexpr float ball_speed_inc_ratio = 0.3f;
+	static constexpr float ball_speed_inc_interval = 1.0f;
+	// allow max 10 times faster than init speed (the larger the harder for the game)
+	static constexpr float ball_speed_max_multiplier = 10.0f;
+
+	// All balls in the game, stored as a structure of arrays
+	// (so the per-frame integration loop streams through just the values it needs):
+	struct Balls {
+		// add a ball with the given init position & velocity at game time 'time_'
+		void push_back(glm::vec2 pos_, glm::vec2 vel_, float time_);
+		size_t size() const { return age.size(); }
+		glm::vec2 position(size_t i) const { return glm::vec2(position_x[i], position_y[i]); }
+		glm::vec2 velocity(size_t i) const { return glm::vec2(velocity_x[i], velocity_y[i]); }
+		//position blended between the start (alpha = 0) and end (alpha = 1) of the last update:
+		glm::vec2 interpolated_position(size_t i, float alpha) const {
+			return glm::mix(glm::vec2(previous_position_x[i], previous_position_y[i]), position(i), alpha);
+		}
+
+		std::vector< float > position_x, position_y;
+		// position at the start of the last update (for interpolated drawing):
+		std::vector< float > previous_position_x, previous_position_y;
+		// velocity will increase as time goes by
+		std::vector< float > velocity_x, velocity_y;
+		// how long does this ball exist (used to decide when to spawn the next ball)
+		std::vector< float > age;
+		// (1 + ball_speed_inc_ratio) ^ (age / ball_speed_inc_interval), capped at ball_speed_max_multiplier;
+		// kept up to date incrementally by update_ball_speeds() instead of calling pow() per ball:
+		std::vector< float > speed_multiplier;
+		// balls are stored oldest-first, so the ones whose multiplier has hit the cap are always a prefix;
+		// balls [0, saturated) are at ball_speed_max_multiplier and are skipped when updating speeds:
+		size_t saturated = 0;
+		std::vector< Trail > trail;
+	};
+	Balls balls;
+
+	//broadphase for paddle-vs-ball and ball-vs-ball collisions (rebuilt every update):
+	BallGrid grid;
+	//if set, balls also bounce off each other:
+	bool ball_collisions = false;
+
+	//balls near a paddle are moved contact-to-contact (so fast balls can't pass through paddles);
+	// at most this many bounces are resolved per ball per update:
+	static constexpr uint32_t max_bounces = 8;
+	//balls being swept this update and their velocities at the start of it (kept as members to avoid reallocating):
+	std::vector< uint32_t > swept;
+	std::vector< glm::vec2 > swept_velocity;
+
+	//total simulated time (in seconds):
+	float time = 0.0f;
+
+	//random numbers for ball spawning and the ai (reseed before the first update for a different game):
+	Xoshiro128 rng;
+
+	//----- helpers -----
+
+	//move an ai-controlled paddle away from the nearest in-coming ball:
+	void update_ai(glm::vec2 &paddle, int &moving_direction, float elapsed);
+
+	//age all balls by 'elapsed' and grow their speed multipliers to match:
+	void update_ball_speeds(float elapsed);
+
+	//resize the broadphase grid if the court or ball count has changed enough:
+	void resize_grid();
+
+	//move a ball forward by 'elapsed' seconds, bouncing off paddles and walls at the exact moment of contact:
+	void sweep_ball(uint32_t ball, float elapsed);
+};
@@ -1,4 +1,7 @@
-#include "ColorTextureProgram.hpp"
+#include "InstancedQuadProgram.hpp"
+#include "StreamingBuffer.hpp"
+#include "KillerPongGame.hpp"
+#include "GpuTimer.hpp"
 
 #include "Mode.hpp"
 #include "GL.hpp"
@@ -6,98 +9,77 @@
 #include <glm/glm.hpp>
 
 #include <vector>
-#include <deque>
 
 /*
  * KillerPongMode is a game mode that implements a single-player game of Pong.
+ * The simulation itself lives in KillerPongGame; this mode feeds it mouse input and draws it.
  */
 
 struct KillerPongMode : Mode {
-    KillerPongMode();
+	KillerPongMode();
 	virtual ~KillerPongMode();
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
 	virtual void update(float elapsed) override;
+	virtual void set_interpolation(float alpha) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
-	bool is_complete();
 
 	//----- game state -----
-	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
-    glm::vec2 paddle_radius = glm::vec2(0.2f, 1.0f);
-	glm::vec2 ball_radius = glm::vec2(0.2f, 0.2f);
-
-	glm::vec2 left_paddle = glm::vec2(-court_radius.x + 0.5f, 0.0f);
-	glm::vec2 right_paddle = glm::vec2( court_radius.x - 0.5f, 0.0f);
-
-    // initially every one has 20 hps, if got hit by the ball, reduce 1 hp
-    uint32_t init_hp = 15;
-	uint32_t left_hp = init_hp;
-	uint32_t right_hp = init_hp;
-	// when losing 1 hp, there are invincible_sec seconds for invincible
-	float invincible_sec = 1.0f;
-    float left_invincible_elapsed = 1.0f;
-    float right_invincible_elapsed = 1.0f;
-
-    // when hit by a ball, color of the paddle will change to red, the red will last for hit_color_change_sec seconds
-    float hit_color_change_sec = 0.05f;
-
-    // how fast can this ai move (the larger the harder to beat the ai)
-	float ai_speed_factor = 7.0f;
-	// 1: currently moving up, -1: moving down, 0: not moving
-	int ai_moving_direction = 0;
-
-	// time length (in seconds) of the ball trail
-    static constexpr float trail_length = 0.1f;
-    // create a new ball every 5 secs
-    static constexpr float ball_create_interval = 5.0f;
-
-    // increase speed of each ball by ball_speed_inc_ratio (%) every ball_speed_inc_interval (s) seconds
-    static constexpr float ball_speed_inc_ratio = 0.3f;
-    static constexpr float ball_speed_inc_interval = 1.0f;
-    // allow max 10 times faster than init speed (the larger the harder for the game)
-    static constexpr float ball_speed_max_multiplier = 10.0f;
-
-    // Represents a single ball in the game
-    struct Ball {
-        // init the ball's init position & velocity
-        Ball(glm::vec2 pos_, glm::vec2 vel_):position(pos_), velocity(vel_), age(0) {
-            trail.emplace_back(position, trail_length);
-            trail.emplace_back(position, 0.0f);
-        }
-        glm::vec2 position;
-        // velocity will increase as time goes by
-        glm::vec2 velocity;
-        std::deque< glm::vec3 > trail;
-        // how long does this ball exist (to calculate the speed)
-        float age;
-    };
-    std::vector<Ball> balls;
+	KillerPongGame game;
+
+	//how far between the game's previous and current state to draw (set by set_interpolation):
+	float interpolation = 1.0f;
+
+	// when hit by a ball, color of the paddle will change to red, the red will last for hit_color_change_sec seconds
+	float hit_color_change_sec = 0.05f;
 
 	//----- opengl assets / helpers ------
 
-	//draw functions will work on vectors of vertices, defined as follows:
-	struct Vertex {
-		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
-			Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
-		glm::vec3 Position;
+	//draw functions will work on vectors of quads (one per rectangle), defined as follows:
+	struct Quad {
+		Quad(glm::vec2 const &Center_, glm::vec2 const &Radius_, glm::u8vec4 const &Color_) :
+			Center(Center_), Radius(Radius_), Color(Color_) { }
+		glm::vec2 Center;
+		glm::vec2 Radius;
 		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
 	};
-	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "KillerPongMode::Vertex should be packed");
+	static_assert(sizeof(Quad) == 4*2 + 4*2 + 1*4, "KillerPongMode::Quad should be packed");
+
+	//Shader program that expands each Quad into a rectangle tinted with its color:
+	InstancedQuadProgram quad_program;
 
-	//Shader program that draws transformed, vertices tinted with vertex colors:
-	ColorTextureProgram color_texture_program;
+	//quads are accumulated here during drawing (cleared every frame, but keeps its capacity):
+	std::vector< Quad > quads;
 
-	//Buffer used to hold vertex data during drawing:
-	GLuint vertex_buffer = 0;
+	//Buffer used to stream quads to the GPU during drawing:
+	StreamingBuffer quad_buffer;
 
-	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
-	GLuint vertex_buffer_for_color_texture_program = 0;
+	//Quads that only change when the court size or the hp changes (walls, their shadows, and hp pips)
+	// are kept in their own buffer and only re-uploaded when one of those changes:
+	std::vector< Quad > static_quads;
+	GLuint static_quad_buffer = 0;
+	//static_quads [0, static_background_count) are drawn under the moving things, the rest over them:
+	uint32_t static_background_count = 0;
+	//what static_quads was built for (the hp starts at an impossible value so the first draw() builds it):
+	glm::vec2 static_court_radius = glm::vec2(0.0f);
+	uint32_t static_left_hp = -1U;
+	uint32_t static_right_hp = -1U;
+
+	//Vertex Array Object that maps per-instance data to quad_program attribute locations:
+	// (the attribute pointers are re-pointed for every draw_quads() call, since quads come from either buffer at various offsets)
+	GLuint quads_for_quad_program = 0;
+
+	//draw 'count' quads starting 'offset' bytes into 'buffer':
+	// (expects quad_program and white_tex to be bound already)
+	void draw_quads(GLuint buffer, GLintptr offset, size_t count);
 
 	//Solid white texture:
 	GLuint white_tex = 0;
 
+	//GPU time for the clear, the uploads, and the draws (reported through the profiler):
+	GpuTimer gpu_timer;
+
 	//matrix that maps from clip coordinates to court-space coordinates:
 	glm::mat3x2 clip_to_court = glm::mat3x2(1.0f);
 	// computed in draw() as the inverse of OBJECT_TO_CLIP
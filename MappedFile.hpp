@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * MappedFile maps a whole file read-only into memory, so it can be parsed in place
+ * (e.g. by the in-memory load_png) instead of being copied through a stream.
+ * The operating system pages it in as it is read; nothing is allocated on the heap.
+ */
+
+struct MappedFile {
+	//map 'filename' (throws on failure):
+	MappedFile(std::string const &filename);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	uint8_t const *data = nullptr; //(nullptr for an empty file)
+	size_t size = 0;
+
+	//----- internals -----
+#ifdef _WIN32
+	void *file = nullptr; //HANDLE
+	void *mapping = nullptr; //HANDLE
+#else
+	int fd = -1;
+#endif
+};
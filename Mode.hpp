@@ -15,8 +15,17 @@ struct Mode : std::enable_shared_from_this< Mode > {
 
 	//update is called at the start of a new frame, after events are handled:
 	// 'elapsed' is time in seconds since the last call to 'update'
+	// (the main loop calls update zero or more times per frame with a fixed 'elapsed' of Mode::Tick)
 	virtual void update(float elapsed) { }
 
+	//set_interpolation is called after update, just before draw:
+	// 'alpha' in [0,1) is how far the current time is between the last update and the next one,
+	// so modes can blend between their previous and current state to draw smooth motion.
+	virtual void set_interpolation(float alpha) { }
+
+	//fixed simulation step (in seconds) used by the main loop:
+	static constexpr float Tick = 1.0f / 240.0f;
+
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
@@ -0,0 +1,124 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+Profiler profiler;
+
+constexpr uint32_t Profiler::Window; //(std::min takes it by reference, which needs a definition in C++14)
+
+char const *Profiler::phase_name(Phase phase) {
+	switch (phase) {
+		case Events: return "events";
+		case Update: return "update";
+		case Draw: return "draw";
+		case Swap: return "swap";
+		case GpuClear: return "gpu_clear";
+		case GpuUpload: return "gpu_upload";
+		case GpuDraw: return "gpu_draw";
+		case Frame: return "frame";
+		default: return "?";
+	}
+}
+
+#if KILLER_PONG_PROFILE
+
+Profiler::Profiler() {
+	for (size_t i = 0; i < Capacity; ++i) {
+		queue[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+Profiler::Scope::~Scope() {
+	auto end = std::chrono::high_resolution_clock::now();
+	profiler.record(phase, std::chrono::duration< float, std::milli >(end - start).count());
+}
+
+void Profiler::record(Phase phase, float ms) {
+	//claim a slot by bumping enqueue_at, but only if the consumer is done with it:
+	size_t at = enqueue_at.load(std::memory_order_relaxed);
+	Sample *sample;
+	while (true) {
+		sample = &queue[at % Capacity];
+		size_t sequence = sample->sequence.load(std::memory_order_acquire);
+		if (sequence == at) {
+			if (enqueue_at.compare_exchange_weak(at, at + 1, std::memory_order_relaxed)) break;
+		} else if (sequence < at) {
+			//queue is full (the consumer hasn't read this slot since the last time around):
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			//another producer got this slot first:
+			at = enqueue_at.load(std::memory_order_relaxed);
+		}
+	}
+	sample->phase = phase;
+	sample->ms = ms;
+	//publish to the consumer:
+	sample->sequence.store(at + 1, std::memory_order_release);
+}
+
+void Profiler::end_frame() {
+	auto now = std::chrono::high_resolution_clock::now();
+
+	float *frame = window[frame_count % Window];
+	std::fill(frame, frame + PhaseCount, 0.0f);
+
+	//sum up everything recorded since the last end_frame():
+	while (true) {
+		Sample &sample = queue[dequeue_at % Capacity];
+		if (sample.sequence.load(std::memory_order_acquire) != dequeue_at + 1) break;
+		if (sample.phase < PhaseCount) frame[sample.phase] += sample.ms;
+		//hand the slot back to producers for the next time around:
+		sample.sequence.store(dequeue_at + Capacity, std::memory_order_release);
+		dequeue_at += 1;
+	}
+
+	frame[Frame] = std::chrono::duration< float, std::milli >(now - frame_start).count();
+	frame_start = now;
+
+	if (csv.is_open()) {
+		csv << frame_count;
+		for (uint32_t p = 0; p < PhaseCount; ++p) {
+			csv << "," << frame[p];
+		}
+		csv << "\n";
+	}
+
+	frame_count += 1;
+}
+
+void Profiler::update_stats() {
+	//percentiles over the window:
+	uint32_t count = std::min(frame_count, Window);
+	if (count == 0) return;
+	float sorted[Window];
+	for (uint32_t p = 0; p < PhaseCount; ++p) {
+		for (uint32_t i = 0; i < count; ++i) {
+			sorted[i] = window[i][p];
+		}
+		std::sort(sorted, sorted + count);
+		stats[p].p50 = sorted[count / 2];
+		stats[p].p99 = sorted[std::min(count - 1, count * 99 / 100)];
+		stats[p].max = sorted[count - 1];
+	}
+}
+
+void Profiler::start_csv(std::string const &filename) {
+	csv.open(filename);
+	if (!csv) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+
+	csv << "frame";
+	for (uint32_t p = 0; p < PhaseCount; ++p) {
+		csv << "," << phase_name(Phase(p)) << "_ms";
+	}
+	csv << "\n";
+}
+
+void Profiler::stop_csv() {
+	csv.close();
+	if (csv.fail()) throw std::runtime_error("Failed to write profiler CSV.");
+}
+
+#endif //KILLER_PONG_PROFILE
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Profiler collects per-frame CPU times for the phases of the main loop.
+ *
+ * Code marks a phase with PROFILE_SCOPE(Phase), which times the rest of the enclosing block.
+ * Timings go into a lock-free queue (so any thread can record them), and end_frame() -- called
+ * once per frame from the main loop -- adds them up into that frame's per-phase totals.
+ * Only the last Window frames are kept; update_stats() works out their p50/p99/max for the
+ * overlay (see ProfilerOverlay.hpp), and with start_csv() every frame is also written out as it ends.
+ *
+ * GPU times are measured with GpuTimer and recorded here as their own phases.
+ *
+ * Build with -DKILLER_PONG_PROFILE=0 to compile the profiler out entirely: PROFILE_SCOPE (and
+ * GPU_PROFILE_SCOPE) become nothing, and the rest of the interface becomes empty inline stubs.
+ */
+
+#ifndef KILLER_PONG_PROFILE
+#define KILLER_PONG_PROFILE 1
+#endif
+
+struct Profiler {
+	enum Phase : uint8_t {
+		Events, //polling and handling SDL events
+		Update, //Mode::update (all of the frame's fixed steps)
+		Draw, //Mode::draw
+		Swap, //SDL_GL_SwapWindow
+		GpuClear, //GPU time for clearing the framebuffer (see GpuTimer.hpp)
+		GpuUpload, //GPU time for uploading vertex data
+		GpuDraw, //GPU time for draw calls
+		Frame, //whole frame, measured between end_frame() calls
+		PhaseCount
+	};
+	static char const *phase_name(Phase phase);
+
+	//percentiles over the last Window frames (in milliseconds):
+	static constexpr uint32_t Window = 240;
+	struct Stats {
+		float p50 = 0.0f;
+		float p99 = 0.0f;
+		float max = 0.0f;
+	};
+	Stats stats[PhaseCount];
+
+#if KILLER_PONG_PROFILE
+	//times from its construction to its destruction (use through PROFILE_SCOPE):
+	struct Scope {
+		Scope(Phase phase_) : phase(phase_), start(std::chrono::high_resolution_clock::now()) { }
+		~Scope();
+		Phase phase;
+		std::chrono::high_resolution_clock::time_point start;
+	};
+
+	//add 'ms' to 'phase' in the current frame (safe to call from any thread; dropped if the queue is full):
+	void record(Phase phase, float ms);
+
+	//close the current frame (main thread only):
+	void end_frame();
+
+	//fill in 'stats' from the frames in the window (main thread only; only worth it while they're shown):
+	void update_stats();
+
+	//per-phase milliseconds for the last Window frames (a ring; frame f is at window[f % Window]):
+	float window[Window][PhaseCount];
+	uint32_t frame_count = 0; //frames ended so far
+
+	//write each frame to 'filename' as a CSV line as it ends, until stop_csv() (both throw on failure):
+	void start_csv(std::string const &filename);
+	void stop_csv();
+	std::ofstream csv;
+
+	//samples dropped because the queue was full:
+	std::atomic< uint32_t > dropped{0};
+
+	//----- internals -----
+
+	//bounded multi-producer, single-consumer queue of samples
+	// (each slot has a sequence number that says whether it is ready to write or to read):
+	struct Sample {
+		std::atomic< size_t > sequence;
+		Phase phase;
+		float ms;
+	};
+	static constexpr size_t Capacity = 1024; //(power of two)
+	Sample queue[Capacity];
+	std::atomic< size_t > enqueue_at{0};
+	size_t dequeue_at = 0;
+
+	std::chrono::high_resolution_clock::time_point frame_start = std::chrono::high_resolution_clock::now();
+
+	Profiler();
+#else
+	//(compiled out: nothing is recorded, and the stats stay zero)
+	void record(Phase, float) { }
+	void end_frame() { }
+	void update_stats() { }
+	static constexpr uint32_t frame_count = 0;
+	void start_csv(std::string const &) { throw std::runtime_error("Profiling was compiled out (KILLER_PONG_PROFILE=0), so there are no timings to write."); }
+	void stop_csv() { }
+#endif
+};
+
+//the main loop's profiler:
+extern Profiler profiler;
+
+#if KILLER_PONG_PROFILE
+#define PROFILE_SCOPE_NAME2(LINE) profile_scope_ ## LINE
+#define PROFILE_SCOPE_NAME(LINE) PROFILE_SCOPE_NAME2(LINE)
+#define PROFILE_SCOPE(PHASE) Profiler::Scope PROFILE_SCOPE_NAME(__LINE__)(Profiler::PHASE)
+#else
+#define PROFILE_SCOPE(PHASE)
+#endif
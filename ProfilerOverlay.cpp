@@ -0,0 +1,174 @@
+#include "ProfilerOverlay.hpp"
+
+//for the GL_ERRORS() macro:
+#include "gl_errors.hpp"
+
+//for glm::value_ptr() :
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+ProfilerOverlay::ProfilerOverlay() {
+	{ //vertex buffer:
+		glGenBuffers(1, &vertex_buffer);
+		//for now, buffer will be un-filled.
+
+		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	}
+
+	{ //vertex array mapping buffer for color_texture_program:
+		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
+		glBindVertexArray(vertex_buffer_for_color_texture_program);
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+		glVertexAttribPointer(
+			color_texture_program.Position_vec4, //attribute
+			3, //size
+			GL_FLOAT, //type
+			GL_FALSE, //normalized
+			sizeof(Vertex), //stride
+			(GLbyte *)0 + 0 //offset
+		);
+		glEnableVertexAttribArray(color_texture_program.Position_vec4);
+
+		glVertexAttribPointer(
+			color_texture_program.Color_vec4, //attribute
+			4, //size
+			GL_UNSIGNED_BYTE, //type
+			GL_TRUE, //normalized
+			sizeof(Vertex), //stride
+			(GLbyte *)0 + 4*3 //offset
+		);
+		glEnableVertexAttribArray(color_texture_program.Color_vec4);
+
+		glVertexAttribPointer(
+			color_texture_program.TexCoord_vec2, //attribute
+			2, //size
+			GL_FLOAT, //type
+			GL_FALSE, //normalized
+			sizeof(Vertex), //stride
+			(GLbyte *)0 + 4*3 + 4*1 //offset
+		);
+		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+
+		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	}
+
+	{ //solid white texture (1x1, so no mipmaps needed):
+		glGenTextures(1, &white_tex);
+		glBindTexture(GL_TEXTURE_2D, white_tex);
+		glm::u8vec4 white = glm::u8vec4(0xff);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	}
+}
+
+ProfilerOverlay::~ProfilerOverlay() {
+	glDeleteBuffers(1, &vertex_buffer);
+	vertex_buffer = 0;
+
+	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
+	vertex_buffer_for_color_texture_program = 0;
+
+	glDeleteTextures(1, &white_tex);
+	white_tex = 0;
+}
+
+void ProfilerOverlay::draw(Profiler const &profiler, glm::uvec2 const &drawable_size) {
+	//layout (in pixels, from the top left of the window):
+	const float margin = 8.0f;
+	const float row_height = 10.0f;
+	const float row_gap = 4.0f;
+	const float px_per_ms = 12.0f;
+	const float max_ms = 1000.0f / 30.0f;
+
+	const glm::u8vec4 background_color = glm::u8vec4(0x00, 0x00, 0x00, 0xa0);
+	const glm::u8vec4 ms_color = glm::u8vec4(0xff, 0xff, 0xff, 0x20);
+	const glm::u8vec4 budget_color = glm::u8vec4(0xff, 0xff, 0xff, 0x80);
+	const glm::u8vec4 max_color = glm::u8vec4(0xff, 0xff, 0xff, 0xff);
+	const glm::u8vec4 phase_colors[Profiler::PhaseCount] = {
+		glm::u8vec4(0x54, 0xa0, 0xd1, 0xff), //events
+		glm::u8vec4(0x54, 0xd1, 0x7a, 0xff), //update
+		glm::u8vec4(0xd1, 0xbb, 0x54, 0xff), //draw
+		glm::u8vec4(0xd1, 0x54, 0xb8, 0xff), //swap
+		glm::u8vec4(0xa0, 0x54, 0xd1, 0xff), //gpu clear
+		glm::u8vec4(0x7a, 0x54, 0xd1, 0xff), //gpu upload
+		glm::u8vec4(0xd1, 0x7a, 0x54, 0xff), //gpu draw
+		glm::u8vec4(0xe0, 0xe0, 0xe0, 0xff), //frame
+	};
+
+	vertices.clear();
+
+	//rectangles are given as [min, max] in pixels with +y down:
+	auto draw_rectangle = [this](glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color) {
+		vertices.emplace_back(glm::vec3(min.x, min.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(max.x, min.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(max.x, max.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+
+		vertices.emplace_back(glm::vec3(min.x, min.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(max.x, max.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(min.x, max.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+	};
+	auto ms_to_x = [&](float ms) {
+		return margin + std::min(ms, max_ms) * px_per_ms;
+	};
+
+	float height = Profiler::PhaseCount * (row_height + row_gap) - row_gap;
+	draw_rectangle(glm::vec2(margin - 2.0f), glm::vec2(ms_to_x(max_ms) + 2.0f, margin + height + 2.0f), background_color);
+	for (uint32_t ms = 1; ms < max_ms; ++ms) {
+		draw_rectangle(glm::vec2(ms_to_x(float(ms)), margin), glm::vec2(ms_to_x(float(ms)) + 1.0f, margin + height), ms_color);
+	}
+	draw_rectangle(glm::vec2(ms_to_x(1000.0f / 60.0f), margin), glm::vec2(ms_to_x(1000.0f / 60.0f) + 1.0f, margin + height), budget_color);
+
+	for (uint32_t p = 0; p < Profiler::PhaseCount; ++p) {
+		Profiler::Stats const &stats = profiler.stats[p];
+		float y = margin + p * (row_height + row_gap);
+		glm::u8vec4 dim = phase_colors[p];
+		dim.a = 0x70;
+		draw_rectangle(glm::vec2(margin, y), glm::vec2(ms_to_x(stats.p99), y + row_height), dim);
+		draw_rectangle(glm::vec2(margin, y + 2.0f), glm::vec2(ms_to_x(stats.p50), y + row_height - 2.0f), phase_colors[p]);
+		draw_rectangle(glm::vec2(ms_to_x(stats.max) - 1.0f, y), glm::vec2(ms_to_x(stats.max) + 1.0f, y + row_height), max_color);
+	}
+
+	//pixels (+y down) to clip space:
+	glm::mat4 pixel_to_clip = glm::mat4(
+		glm::vec4(2.0f / drawable_size.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, -2.0f / drawable_size.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(-1.0f, 1.0f, 0.0f, 1.0f)
+	);
+
+	//---- actual drawing ----
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	//upload vertices to vertex_buffer:
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(color_texture_program.program);
+	glUniformMatrix4fv(color_texture_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(pixel_to_clip));
+
+	glBindVertexArray(vertex_buffer_for_color_texture_program);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, white_tex);
+
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS(); //PARANOIA: print errors just in case we did something wrong.
+}
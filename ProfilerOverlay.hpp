@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Profiler.hpp"
+#include "ColorTextureProgram.hpp"
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/*
+ * ProfilerOverlay draws the profiler's per-phase p50/p99/max (CPU phases, then GPU phases, then
+ *  the whole frame) as bars in the corner of the window:
+ *  one row per phase, with the p99 bar behind the (brighter) p50 bar and a white tick at the max,
+ *  over a background that marks off every millisecond and ends at 1/30s (the 1/60s mark is brighter).
+ */
+
+struct ProfilerOverlay {
+	ProfilerOverlay();
+	~ProfilerOverlay();
+
+	//draw over whatever is in the framebuffer:
+	void draw(Profiler const &profiler, glm::uvec2 const &drawable_size);
+
+	//draw functions will work on vectors of vertices, defined as follows:
+	struct Vertex {
+		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
+			Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
+		glm::vec3 Position;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "ProfilerOverlay::Vertex should be packed");
+
+	//Shader program that draws transformed, vertices tinted with vertex colors:
+	ColorTextureProgram color_texture_program;
+
+	//vertices are accumulated here during drawing (cleared every frame, but keeps its capacity):
+	std::vector< Vertex > vertices;
+
+	//Buffer used to hold vertex data during drawing:
+	GLuint vertex_buffer = 0;
+
+	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
+	GLuint vertex_buffer_for_color_texture_program = 0;
+
+	//Solid white texture:
+	GLuint white_tex = 0;
+};
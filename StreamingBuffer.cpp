@@ -0,0 +1,67 @@
+#include "StreamingBuffer.hpp"
+
+#include "gl_errors.hpp"
+
+#include <cstring>
+#include <cassert>
+
+StreamingBuffer::StreamingBuffer(GLsizeiptr element_size_) : element_size(element_size_) {
+	assert(element_size > 0);
+	glGenBuffers(1, &buffer);
+	//for now, buffer will be un-filled.
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (auto &f : fences) {
+		if (f) glDeleteSync(f);
+		f = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+GLintptr StreamingBuffer::upload(void const *data, GLsizeiptr size) {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	segment = (segment + 1) % Segments;
+
+	if (size > segment_size) {
+		//grow to (at least) double the needed size, in whole elements, so this happens rarely:
+		GLsizeiptr elements = (2 * size + element_size - 1) / element_size;
+		segment_size = elements * element_size;
+		//re-specifying the store orphans the old one; the driver frees it once the GPU is done with it:
+		glBufferData(GL_ARRAY_BUFFER, segment_size * Segments, nullptr, GL_STREAM_DRAW);
+		//...so nothing in the new store is in use:
+		for (auto &f : fences) {
+			if (f) glDeleteSync(f);
+			f = 0;
+		}
+	} else if (fences[segment]) {
+		//wait until the GPU is done with the draws that last read this segment:
+		// (with three segments this is normally already signaled)
+		while (glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 /* 1ms */) == GL_TIMEOUT_EXPIRED) { }
+		glDeleteSync(fences[segment]);
+		fences[segment] = 0;
+	}
+
+	GLintptr offset = segment * segment_size;
+	if (size == 0) return offset;
+
+	void *dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst) {
+		std::memcpy(dst, data, size_t(size));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	} else {
+		//mapping shouldn't fail, but if it does the plain (possibly synchronizing) path still works:
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	}
+
+	return offset;
+}
+
+void StreamingBuffer::fence() {
+	if (fences[segment]) glDeleteSync(fences[segment]);
+	fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+/*
+ * StreamingBuffer is a buffer object for vertex data that is rewritten every frame.
+ * The buffer is split into 'Segments' equal regions that are written round-robin; each
+ * region is fenced once the draws reading it have been issued, so later writes can map
+ * it with GL_MAP_UNSYNCHRONIZED_BIT (no implicit driver sync) and only wait if the GPU
+ * is really still using it. Storage is kept between frames and only grows.
+ */
+
+struct StreamingBuffer {
+	//'element_size' is the size of one vertex (or instance) in bytes;
+	// segments are always a whole number of elements so upload() offsets land on element boundaries:
+	StreamingBuffer(GLsizeiptr element_size);
+	~StreamingBuffer();
+
+	//copy 'size' bytes into the next segment and return their byte offset within 'buffer':
+	// (leaves 'buffer' bound to GL_ARRAY_BUFFER)
+	GLintptr upload(void const *data, GLsizeiptr size);
+
+	//call after issuing the draws that read the most recent upload():
+	void fence();
+
+	GLuint buffer = 0;
+
+	static constexpr uint32_t Segments = 3;
+	GLsizeiptr element_size = 1;
+	GLsizeiptr segment_size = 0; //in bytes
+	uint32_t segment = 0; //segment used by the most recent upload()
+	GLsync fences[Segments] = { };
+};
@@ -0,0 +1,150 @@
+#include "TextureAtlas.hpp"
+
+//for the GL_ERRORS() macro:
+#include "gl_errors.hpp"
+
+//for glm::value_ptr() :
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+//vertex buffer and vertex array object, set up the same way as ProfilerOverlay's:
+static void make_vertex_buffer(ColorTextureProgram const &program, GLuint *vertex_buffer, GLuint *vao) {
+	glGenBuffers(1, vertex_buffer);
+
+	glGenVertexArrays(1, vao);
+	glBindVertexArray(*vao);
+	glBindBuffer(GL_ARRAY_BUFFER, *vertex_buffer);
+
+	glVertexAttribPointer(program.Position_vec4, 3, GL_FLOAT, GL_FALSE, sizeof(TextureAtlas::Vertex), (GLbyte *)0 + 0);
+	glEnableVertexAttribArray(program.Position_vec4);
+
+	glVertexAttribPointer(program.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextureAtlas::Vertex), (GLbyte *)0 + 4*3);
+	glEnableVertexAttribArray(program.Color_vec4);
+
+	glVertexAttribPointer(program.TexCoord_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(TextureAtlas::Vertex), (GLbyte *)0 + 4*3 + 4*1);
+	glEnableVertexAttribArray(program.TexCoord_vec2);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+TextureAtlas::TextureAtlas(std::string const &png_filename, std::string const &index_filename) {
+	glm::uvec2 size;
+	std::vector< AtlasSprite > atlas_sprites;
+	load_atlas_index(index_filename, &size, &atlas_sprites);
+	set_sprites(size, atlas_sprites);
+
+	loading = texture_loader.load(png_filename);
+
+	make_vertex_buffer(color_texture_program, &vertex_buffer, &vertex_buffer_for_color_texture_program);
+}
+
+TextureAtlas::TextureAtlas(glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels, std::vector< AtlasSprite > const &atlas_sprites) {
+	set_sprites(size, atlas_sprites);
+
+	//the packed pixels start at the upper left, but OpenGL wants the lower left row first,
+	// so flip them here and upload the whole image in one call:
+	assert(pixels.size() == size_t(size.x) * size.y);
+	std::vector< glm::u8vec4 > flipped(pixels.size());
+	for (uint32_t y = 0; y < size.y; ++y) {
+		std::copy(pixels.begin() + size_t(y) * size.x, pixels.begin() + size_t(y + 1) * size.x,
+			flipped.begin() + size_t(size.y - 1 - y) * size.x);
+	}
+	glGenTextures(1, &packed_tex);
+	glBindTexture(GL_TEXTURE_2D, packed_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, flipped.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+
+	make_vertex_buffer(color_texture_program, &vertex_buffer, &vertex_buffer_for_color_texture_program);
+}
+
+TextureAtlas::~TextureAtlas() {
+	glDeleteBuffers(1, &vertex_buffer);
+	vertex_buffer = 0;
+
+	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
+	vertex_buffer_for_color_texture_program = 0;
+
+	//(a loaded texture belongs to texture_loader)
+	if (packed_tex) glDeleteTextures(1, &packed_tex);
+	packed_tex = 0;
+}
+
+void TextureAtlas::set_sprites(glm::uvec2 const &size, std::vector< AtlasSprite > const &atlas_sprites) {
+	//(sprite positions count down from the top of the image, texture coordinates count up from the bottom)
+	glm::vec2 inv_size = 1.0f / glm::vec2(size);
+	sprites.clear();
+	for (auto const &atlas_sprite : atlas_sprites) {
+		Sprite &sprite = sprites[atlas_sprite.name];
+		sprite.min_uv = glm::vec2(atlas_sprite.position.x, size.y - (atlas_sprite.position.y + atlas_sprite.size.y)) * inv_size;
+		sprite.max_uv = glm::vec2(atlas_sprite.position.x + atlas_sprite.size.x, size.y - atlas_sprite.position.y) * inv_size;
+		sprite.size = atlas_sprite.size;
+	}
+}
+
+TextureAtlas::Sprite const &TextureAtlas::lookup(std::string const &name) const {
+	auto f = sprites.find(name);
+	if (f == sprites.end()) throw std::runtime_error("No sprite named '" + name + "' in atlas.");
+	return f->second;
+}
+
+GLuint TextureAtlas::tex() const {
+	if (packed_tex) return packed_tex;
+	return (loading ? loading->tex : 0);
+}
+
+void TextureAtlas::add_sprite(std::vector< Vertex > *vertices, Sprite const &sprite, glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color) {
+	vertices->emplace_back(glm::vec3(min.x, min.y, 0.0f), color, glm::vec2(sprite.min_uv.x, sprite.min_uv.y));
+	vertices->emplace_back(glm::vec3(max.x, min.y, 0.0f), color, glm::vec2(sprite.max_uv.x, sprite.min_uv.y));
+	vertices->emplace_back(glm::vec3(max.x, max.y, 0.0f), color, glm::vec2(sprite.max_uv.x, sprite.max_uv.y));
+	vertices->emplace_back(glm::vec3(min.x, min.y, 0.0f), color, glm::vec2(sprite.min_uv.x, sprite.min_uv.y));
+	vertices->emplace_back(glm::vec3(max.x, max.y, 0.0f), color, glm::vec2(sprite.max_uv.x, sprite.max_uv.y));
+	vertices->emplace_back(glm::vec3(min.x, max.y, 0.0f), color, glm::vec2(sprite.min_uv.x, sprite.max_uv.y));
+}
+
+void TextureAtlas::draw(std::vector< Vertex > const &vertices, glm::mat4 const &object_to_clip) {
+	GLuint atlas_tex = tex();
+	if (atlas_tex == 0 || vertices.empty()) return;
+
+	if (loading && !loading_filter_set) {
+		//texture_loader makes mipmapped, repeating textures; sample only the full-size level, and don't wrap:
+		glBindTexture(GL_TEXTURE_2D, atlas_tex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		loading_filter_set = true;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(color_texture_program.program);
+	glUniformMatrix4fv(color_texture_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
+
+	glBindVertexArray(vertex_buffer_for_color_texture_program);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlas_tex);
+
+	//everything, in one call:
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS(); //PARANOIA: print errors just in case we did something wrong.
+}
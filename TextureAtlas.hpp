@@ -0,0 +1,72 @@
+#pragma once
+
+#include "AtlasPacker.hpp"
+#include "TextureLoader.hpp"
+#include "ColorTextureProgram.hpp"
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * TextureAtlas draws sprites packed by AtlasPacker (see AtlasPacker.hpp).
+ *
+ * A mode looks its sprites up by name once, then each frame appends two triangles per sprite --
+ * or per untextured shape, using the "white" sprite -- to one vector of vertices and hands it to
+ * draw(), which binds the atlas and issues a single glDrawArrays for all of them.
+ *
+ * The atlas isn't mipmapped (smaller mip levels would blend neighbouring sprites together).
+ */
+
+struct TextureAtlas {
+	//load an atlas saved by save_atlas (the index right away; the image in the background, through texture_loader):
+	TextureAtlas(std::string const &png_filename, std::string const &index_filename);
+	//use an atlas just made with AtlasPacker::pack (uploaded right away):
+	TextureAtlas(glm::uvec2 const &size, std::vector< glm::u8vec4 > const &pixels, std::vector< AtlasSprite > const &sprites);
+	~TextureAtlas();
+
+	//where a sprite is in the atlas texture:
+	struct Sprite {
+		glm::vec2 min_uv = glm::vec2(0.0f); //lower left corner
+		glm::vec2 max_uv = glm::vec2(0.0f); //upper right corner
+		glm::uvec2 size = glm::uvec2(0); //in pixels
+	};
+	//(throws if there is no sprite named 'name')
+	Sprite const &lookup(std::string const &name) const;
+
+	//vertices are laid out the way ColorTextureProgram expects (same as ProfilerOverlay::Vertex):
+	struct Vertex {
+		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
+			Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
+		glm::vec3 Position;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "TextureAtlas::Vertex should be packed");
+
+	//append two triangles showing 'sprite', tinted by 'color', over the rectangle from 'min' to 'max':
+	static void add_sprite(std::vector< Vertex > *vertices, Sprite const &sprite, glm::vec2 const &min, glm::vec2 const &max, glm::u8vec4 const &color = glm::u8vec4(0xff));
+
+	//draw 'vertices' (as triangles) textured with the atlas, in one draw call:
+	// (draws nothing while the atlas is still loading)
+	void draw(std::vector< Vertex > const &vertices, glm::mat4 const &object_to_clip);
+
+	//the atlas texture (0 while it is still loading):
+	GLuint tex() const;
+
+	//----- internals -----
+	std::unordered_map< std::string, Sprite > sprites;
+	void set_sprites(glm::uvec2 const &size, std::vector< AtlasSprite > const &sprites);
+
+	std::shared_ptr< TextureLoader::Texture const > loading; //when loaded from a file
+	bool loading_filter_set = false; //turned mipmapping off on the loaded texture yet?
+	GLuint packed_tex = 0; //when made from packed pixels
+
+	ColorTextureProgram color_texture_program;
+	GLuint vertex_buffer = 0;
+	GLuint vertex_buffer_for_color_texture_program = 0;
+};
@@ -0,0 +1,183 @@
+#include "TextureLoader.hpp"
+
+#include "MappedFile.hpp"
+#include "Trace.hpp"
+#include "gl_errors.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+TextureLoader texture_loader;
+
+TextureLoader::TextureLoader(uint32_t workers_) : worker_count(workers_) {
+	if (worker_count == 0) {
+		uint32_t cores = std::thread::hardware_concurrency(); //(0 if unknown)
+		worker_count = (cores > 1 ? cores - 1 : 1);
+	}
+}
+
+TextureLoader::~TextureLoader() {
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		requests.clear();
+		stopping = true;
+	}
+	wake_worker.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	if (!textures.empty()) {
+		std::cerr << "NOTE: TextureLoader destroyed without clear(); " << textures.size() << " textures leaked." << std::endl;
+	}
+}
+
+std::shared_ptr< TextureLoader::Texture const > TextureLoader::load(std::string const &filename) {
+	std::shared_ptr< Texture > texture = std::make_shared< Texture >();
+	texture->filename = filename;
+	pending_count.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		textures.emplace_back(texture);
+		requests.emplace_back(texture.get());
+		if (workers.empty()) {
+			stopping = false;
+			for (uint32_t i = 0; i < worker_count; ++i) {
+				workers.emplace_back(&TextureLoader::decode_requests, this);
+			}
+		}
+	}
+	wake_worker.notify_one();
+	return texture;
+}
+
+void TextureLoader::decode_requests() {
+	while (true) {
+		Texture *texture;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake_worker.wait(lock, [this](){ return stopping || !requests.empty(); });
+			if (requests.empty()) break; //(stopping, and nothing left to do)
+			texture = requests.front();
+			requests.pop_front();
+		}
+
+		{ //decode straight from the mapped file into the pixels that will be uploaded:
+			TRACE_SCOPE("decode texture");
+			try {
+				MappedFile file(texture->filename);
+				load_png(file.data, file.size, &texture->size, &texture->pixels, LowerLeftOrigin);
+			} catch (std::exception &e) {
+				texture->failed = true;
+				texture->error = e.what();
+				texture->size = glm::uvec2(0);
+				std::vector< glm::u8vec4 >().swap(texture->pixels);
+			}
+		}
+
+		//hand it to the GL thread (release: everything written above is visible to upload()):
+		texture->next_decoded = decoded.load(std::memory_order_relaxed);
+		while (!decoded.compare_exchange_weak(texture->next_decoded, texture, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
+}
+
+void TextureLoader::upload(float budget_ms) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//take everything the workers have decoded (it comes newest first, so reverse it):
+	Texture *newest = decoded.exchange(nullptr, std::memory_order_acquire);
+	size_t old_size = to_upload.size();
+	for (Texture *texture = newest; texture; texture = texture->next_decoded) {
+		to_upload.emplace_back(texture);
+	}
+	std::reverse(to_upload.begin() + old_size, to_upload.end());
+
+	if (to_upload.empty()) return;
+
+	TRACE_SCOPE("texture upload");
+	do {
+		if (upload_slice()) to_upload.pop_front();
+	} while (!to_upload.empty()
+		&& std::chrono::duration< float, std::milli >(std::chrono::high_resolution_clock::now() - start).count() < budget_ms);
+}
+
+bool TextureLoader::upload_slice() {
+	Texture &texture = *to_upload.front();
+
+	if (texture.failed) {
+		std::cerr << "Failed to load texture '" << texture.filename << "': " << texture.error << std::endl;
+		pending_count.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	if (texture.uploading == 0) { //first slice: make the texture object and allocate its storage
+		glGenTextures(1, &texture.uploading);
+		glBindTexture(GL_TEXTURE_2D, texture.uploading);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.size.x, texture.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	} else {
+		glBindTexture(GL_TEXTURE_2D, texture.uploading);
+	}
+
+	size_t row_bytes = size_t(texture.size.x) * sizeof(glm::u8vec4);
+	uint32_t rows = uint32_t(std::max< size_t >(1, SliceBytes / std::max< size_t >(1, row_bytes)));
+	rows = std::min(rows, texture.size.y - texture.rows_uploaded);
+	if (rows > 0) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, texture.rows_uploaded, texture.size.x, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+			texture.pixels.data() + size_t(texture.rows_uploaded) * texture.size.x);
+		texture.rows_uploaded += rows;
+	}
+
+	bool done = (texture.rows_uploaded == texture.size.y);
+	if (done) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+		texture.tex = texture.uploading;
+		std::vector< glm::u8vec4 >().swap(texture.pixels);
+		pending_count.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	return done;
+}
+
+void TextureLoader::finish() {
+	while (pending() > 0) {
+		upload(std::numeric_limits< float >::infinity());
+		if (pending() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1)); //(workers are still decoding)
+	}
+}
+
+void TextureLoader::clear() {
+	//stop the workers, dropping anything they haven't started on:
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		requests.clear();
+		stopping = true;
+	}
+	wake_worker.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+
+	std::lock_guard< std::mutex > lock(mutex);
+	workers.clear();
+	for (auto &texture : textures) {
+		if (texture->uploading) glDeleteTextures(1, &texture->uploading);
+		texture->uploading = 0;
+		texture->tex = 0;
+	}
+	textures.clear();
+	to_upload.clear();
+	decoded.store(nullptr, std::memory_order_relaxed);
+	pending_count.store(0, std::memory_order_relaxed);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
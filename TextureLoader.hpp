@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GL.hpp"
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+/*
+ * TextureLoader loads PNG textures without stalling the thread that draws.
+ *
+ * load() queues a file for a pool of worker threads, which map it and decode it straight into the
+ * buffer that will be uploaded (see load_png(void const *png, ...)). Decoded textures come back to
+ * the GL thread through a lock-free list; upload() -- called once per frame -- feeds them to OpenGL
+ * a slice of rows at a time and stops once the frame's time budget is spent, so a big texture is
+ * spread over a few frames instead of causing a hitch.
+ *
+ * A Texture's 'tex' is 0 until it has been completely uploaded (draw with a placeholder, like
+ * white_tex, until then). Textures are set up the way the white_tex in KillerPongMode is:
+ * mipmapped, linear filtering, repeating.
+ */
+
+struct TextureLoader {
+	//'workers' decoding threads; 0 means one per core, less one for the GL thread (but at least one):
+	// (the threads are started by the first load())
+	TextureLoader(uint32_t workers = 0);
+	//(stops the workers; textures must have been deleted with clear() while the GL context was still around)
+	~TextureLoader();
+
+	struct Texture {
+		std::string filename;
+		GLuint tex = 0; //texture object, once uploaded
+		glm::uvec2 size = glm::uvec2(0); //(set when 'tex' is)
+		bool failed = false; //couldn't be loaded (the reason was printed to std::cerr)
+
+		//----- internals -----
+		std::vector< glm::u8vec4 > pixels; //decoded (lower-left origin), freed once uploaded
+		std::string error; //why decoding failed
+		GLuint uploading = 0; //texture object being filled
+		uint32_t rows_uploaded = 0;
+		Texture *next_decoded = nullptr; //link in TextureLoader::decoded
+	};
+
+	//start loading 'filename' (may be called from any thread):
+	std::shared_ptr< Texture const > load(std::string const &filename);
+
+	//upload decoded textures, spending about 'budget_ms' milliseconds at most (GL thread, once per frame):
+	// (always makes some progress, even with a budget of 0)
+	void upload(float budget_ms);
+
+	//textures that have been asked for but aren't uploaded (or failed) yet:
+	uint32_t pending() const { return pending_count.load(std::memory_order_relaxed); }
+
+	//wait for every texture asked for so far and upload it all, with no budget (GL thread):
+	void finish();
+
+	//stop loading and delete every texture (GL thread, before the context goes away; not while other threads call load()):
+	void clear();
+
+	//----- internals -----
+
+	//bytes passed to glTexSubImage2D at a time, between checks of the budget:
+	static constexpr size_t SliceBytes = 256 * 1024;
+
+	uint32_t worker_count = 0;
+	std::vector< std::shared_ptr< Texture > > textures; //every texture asked for (to delete them in clear())
+	std::atomic< uint32_t > pending_count{0};
+
+	std::mutex mutex; //protects 'textures', 'requests', 'stopping' and 'workers'
+	std::condition_variable wake_worker;
+	std::deque< Texture * > requests; //waiting to be decoded
+	bool stopping = false;
+	std::vector< std::thread > workers;
+	void decode_requests();
+
+	//decoded textures are pushed onto this lock-free stack by the workers, newest first:
+	std::atomic< Texture * > decoded{nullptr};
+	//...and upload() moves them here, oldest first (GL thread only):
+	std::deque< Texture * > to_upload;
+	//upload one slice of to_upload.front(), returning true if that finished it:
+	bool upload_slice();
+};
+
+//the game's texture loader (upload() is called from the main loop):
+extern TextureLoader texture_loader;
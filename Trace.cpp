@@ -0,0 +1,103 @@
+#include "Trace.hpp"
+
+#include <stdexcept>
+
+Trace trace;
+
+//threads are numbered in the order they first record an event:
+static uint32_t thread_index() {
+	static std::atomic< uint32_t > next_index{1};
+	thread_local uint32_t index = next_index.fetch_add(1);
+	return index;
+}
+
+Trace::~Trace() {
+	stop();
+}
+
+void Trace::start(std::string const &filename) {
+	stop();
+
+	out.open(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"pong\"}}";
+
+	start_time = std::chrono::high_resolution_clock::now();
+	stopping = false;
+	block.reserve(BlockSize);
+	writer = std::thread(&Trace::write_blocks, this);
+	active = true;
+}
+
+void Trace::stop() {
+	if (!writer.joinable()) return;
+	active = false;
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		if (!block.empty()) full.emplace_back(std::move(block));
+		block.clear();
+		stopping = true;
+	}
+	wake_writer.notify_one();
+	writer.join();
+
+	out << "\n]}\n";
+	out.close();
+}
+
+void Trace::event(char const *name, char phase) {
+	Event e;
+	e.name = name;
+	e.phase = phase;
+	e.thread = thread_index();
+	e.ns = uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::high_resolution_clock::now() - start_time).count());
+
+	bool handed_off = false;
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		if (!active) return; //(stopped while this event was being made)
+		block.emplace_back(e);
+		if (block.size() >= BlockSize) {
+			full.emplace_back(std::move(block));
+			block = std::vector< Event >();
+			block.reserve(BlockSize);
+			handed_off = true;
+		}
+	}
+	if (handed_off) wake_writer.notify_one();
+}
+
+void Trace::write_blocks() {
+	std::vector< std::vector< Event > > to_write;
+	while (true) {
+		bool done;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			wake_writer.wait(lock, [this](){ return stopping || !full.empty(); });
+			to_write.swap(full);
+			done = stopping;
+		}
+		for (auto const &events : to_write) {
+			for (Event const &e : events) {
+				//(timestamps are in microseconds)
+				out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase
+				    << "\",\"pid\":1,\"tid\":" << e.thread
+				    << ",\"ts\":" << (e.ns / 1000) << "." << char('0' + (e.ns / 100) % 10) << char('0' + (e.ns / 10) % 10) << char('0' + e.ns % 10)
+				    << "}";
+			}
+		}
+		to_write.clear();
+		if (done) break;
+	}
+	out.flush();
+}
+
+Trace::Scope::Scope(char const *name_) : name(name_) {
+	if (trace.active.load(std::memory_order_relaxed)) trace.event(name, 'B');
+	else name = nullptr;
+}
+
+Trace::Scope::~Scope() {
+	if (name && trace.active.load(std::memory_order_relaxed)) trace.event(name, 'E');
+}
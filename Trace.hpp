@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Trace writes a timeline of begin/end events in Chrome's trace event JSON format, which
+ * chrome://tracing and Perfetto (ui.perfetto.dev) can open.
+ *
+ * Code marks sections with TRACE_SCOPE("name") (until the end of the block) or with matching
+ * TRACE_BEGIN("name") / TRACE_END("name") pairs; names must be string literals (only the
+ * pointer is kept). Nothing is recorded unless trace.start() has been called.
+ *
+ * Events are appended to an in-memory block; full blocks are handed to a background thread
+ * that formats and writes them, so long runs don't hold the whole trace in memory and the
+ * thread being traced never waits on the disk.
+ *
+ * Like PROFILE_SCOPE, the macros compile to nothing when built with -DKILLER_PONG_PROFILE=0.
+ */
+
+#ifndef KILLER_PONG_PROFILE
+#define KILLER_PONG_PROFILE 1
+#endif
+
+struct Trace {
+	~Trace();
+
+	//start writing events to 'filename' (throws on failure):
+	void start(std::string const &filename);
+	//write out everything recorded so far and close the file:
+	void stop();
+
+	//record an event ('B'egin or 'E'nd) for the calling thread (safe to call from any thread):
+	void event(char const *name, char phase);
+
+	//is a trace being recorded?
+	std::atomic< bool > active{false};
+
+	struct Scope {
+		Scope(char const *name_);
+		~Scope();
+		char const *name;
+	};
+
+	//----- internals -----
+
+	struct Event {
+		char const *name;
+		char phase;
+		uint32_t thread; //small per-thread number (see thread_index() in Trace.cpp)
+		uint64_t ns; //since start()
+	};
+	static constexpr size_t BlockSize = 4096; //events per block handed to the writer
+
+	std::chrono::high_resolution_clock::time_point start_time;
+
+	std::mutex mutex; //protects everything below
+	std::condition_variable wake_writer;
+	std::vector< Event > block; //being filled
+	std::vector< std::vector< Event > > full; //waiting to be written
+	bool stopping = false;
+
+	std::thread writer;
+	std::ofstream out; //(only used by the writer thread)
+	void write_blocks();
+};
+
+//the game's trace:
+extern Trace trace;
+
+#if KILLER_PONG_PROFILE
+#define TRACE_SCOPE_NAME2(LINE) trace_scope_ ## LINE
+#define TRACE_SCOPE_NAME(LINE) TRACE_SCOPE_NAME2(LINE)
+#define TRACE_SCOPE(NAME) Trace::Scope TRACE_SCOPE_NAME(__LINE__)(NAME)
+#define TRACE_BEGIN(NAME) do { if (trace.active.load(std::memory_order_relaxed)) trace.event(NAME, 'B'); } while (0)
+#define TRACE_END(NAME) do { if (trace.active.load(std::memory_order_relaxed)) trace.event(NAME, 'E'); } while (0)
+#else
+#define TRACE_SCOPE(NAME)
+#define TRACE_BEGIN(NAME) do { } while (0)
+#define TRACE_END(NAME) do { } while (0)
+#endif
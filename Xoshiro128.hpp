@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Xoshiro128 is a small, fast pseudo-random number generator (xoshiro128+, by Blackman and Vigna).
+ * Unlike rand(), each instance has its own state, so games seeded the same way play out the same way
+ * and games on different threads don't share (or fight over) a generator.
+ */
+
+struct Xoshiro128 {
+	//the state is filled from 'seed' with splitmix64, so any seed (including 0) is fine:
+	explicit Xoshiro128(uint64_t seed = 0);
+
+	//next 32 random bits:
+	uint32_t next();
+	//uniform float in [0, 1):
+	float unit() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+	uint32_t state[4];
+};
+
+inline Xoshiro128::Xoshiro128(uint64_t seed) {
+	for (uint32_t i = 0; i < 4; i += 2) {
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z = z ^ (z >> 31);
+		state[i] = uint32_t(z);
+		state[i+1] = uint32_t(z >> 32);
+	}
+}
+
+inline uint32_t Xoshiro128::next() {
+	uint32_t result = state[0] + state[3];
+	uint32_t t = state[1] << 9;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = (state[3] << 11) | (state[3] >> 21);
+	return result;
+}
@@ -0,0 +1,64 @@
+//atlas_pack packs PNG images into one texture atlas (see AtlasPacker.hpp), saving OUT.png and its index OUT.atlas.
+// Sprites are named after their files (without directory or extension).
+//
+//Usage:
+//  atlas-pack [--padding P] [--max-size S] OUT IMAGE.png [IMAGE.png ...]
+
+#include "AtlasPacker.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+int main(int argc, char **argv) {
+	//------------ parse command line ------------
+	AtlasPacker packer;
+	std::string out;
+	std::vector< std::string > filenames;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		auto next = [&]() -> std::string {
+			if (argi + 1 >= argc) throw std::runtime_error("Expecting a value after '" + arg + "'.");
+			argi += 1;
+			return argv[argi];
+		};
+		if (arg == "--padding") {
+			packer.padding = uint32_t(std::stoul(next()));
+		} else if (arg == "--max-size") {
+			packer.max_size = uint32_t(std::stoul(next()));
+		} else if (arg.size() > 0 && arg[0] != '-') {
+			if (out.empty()) out = arg;
+			else filenames.emplace_back(arg);
+		} else {
+			out.clear();
+			break;
+		}
+	}
+	if (out.empty() || filenames.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--padding P] [--max-size S] OUT IMAGE.png [IMAGE.png ...]" << std::endl;
+		return 1;
+	}
+
+	//------------ pack ------------
+	uint64_t sprite_area = 0;
+	for (auto const &filename : filenames) {
+		packer.add_png(filename);
+		sprite_area += uint64_t(packer.images.back().size.x) * packer.images.back().size.y;
+	}
+
+	glm::uvec2 size;
+	std::vector< glm::u8vec4 > pixels;
+	std::vector< AtlasSprite > sprites;
+	packer.pack(&size, &pixels, &sprites);
+
+	save_atlas(out + ".png", out + ".atlas", size, pixels, sprites);
+
+	std::cout << "Packed " << sprites.size() << " sprites into " << size.x << "x" << size.y
+	          << " (" << (100.0 * double(sprite_area) / (double(size.x) * size.y)) << "% of it sprites, not counting padding)"
+	          << "; wrote '" << out << ".png' and '" << out << ".atlas'." << std::endl;
+
+	return 0;
+}
@@ -1,16 +1,206 @@
 #include "gl_compile_program.hpp"
 
+#include "Trace.hpp"
+
+#include <SDL.h>
+
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
 
-static GLuint gl_compile_shader(GLenum type, std::string const &source) {
-	GLuint shader = glCreateShader(type);
-	GLchar const *str = source.c_str();
-	GLint length = GLint(source.size());
-	glShaderSource(shader, 1, &str, &length);
-	glCompileShader(shader);
+//----------------------------------------------------------------
+//Program binary cache.
+//glGetProgramBinary and friends are GL 4.1 (or ARB_get_program_binary), which GL.hpp doesn't cover,
+// so they are looked up (once there is a context) with SDL_GL_GetProcAddress.
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+struct ProgramBinaryCache {
+	std::string directory; //empty: cache is off
+
+	bool checked = false; //looked for program binary support yet?
+	bool supported = false;
+	void (APIENTRY *GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = nullptr;
+	void (APIENTRY *ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = nullptr;
+	void (APIENTRY *ProgramParameteri)(GLuint program, GLenum pname, GLint value) = nullptr;
+
+	//is the cache on (and usable with this driver)?
+	bool enabled() {
+		if (directory.empty()) return false;
+		if (!checked) {
+			checked = true;
+			GLint major = 0, minor = 0;
+			glGetIntegerv(GL_MAJOR_VERSION, &major);
+			glGetIntegerv(GL_MINOR_VERSION, &minor);
+			if (major > 4 || (major == 4 && minor >= 1) || SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+				GetProgramBinary = (decltype(GetProgramBinary))SDL_GL_GetProcAddress("glGetProgramBinary");
+				ProgramBinary = (decltype(ProgramBinary))SDL_GL_GetProcAddress("glProgramBinary");
+				ProgramParameteri = (decltype(ProgramParameteri))SDL_GL_GetProcAddress("glProgramParameteri");
+				//(some drivers have the functions but no formats to save in)
+				GLint formats = 0;
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+				supported = (GetProgramBinary && ProgramBinary && ProgramParameteri && formats > 0);
+			}
+			if (!supported) {
+				std::cerr << "NOTE: OpenGL driver can't save program binaries; shader programs won't be cached." << std::endl;
+			}
+		}
+		return supported;
+	}
+
+	//everything a cached program depends on:
+	std::string key(std::string const &vertex_shader_source, std::string const &fragment_shader_source) {
+		std::string key;
+		for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+			GLubyte const *str = glGetString(name);
+			key += (str ? reinterpret_cast< char const * >(str) : "");
+			key += '\n';
+		}
+		key += vertex_shader_source;
+		key += '\0';
+		key += fragment_shader_source;
+		return key;
+	}
+
+	//file the program with 'key' is kept in (named after a 64-bit FNV-1a hash of the key):
+	std::string filename(std::string const &key) {
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (char c : key) {
+			hash = (hash ^ uint8_t(c)) * 0x100000001b3ULL;
+		}
+		char hex[17];
+		snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+		return directory + "program-" + hex + ".bin";
+	}
+
+	//file format: magic, then binary format, key length, binary length (uint32_t's), then the key and the binary.
+	// (the whole key is stored, so a hash collision can't load the wrong program; the lengths are checked against the file's size)
+	static constexpr char const *Magic = "kpb1";
+
+	//make a program from the cache (returns 0 if it isn't there, or the driver won't take it):
+	GLuint load(std::string const &key) {
+		std::ifstream file(filename(key), std::ios::binary);
+		if (!file) return 0;
+
+		char magic[4];
+		uint32_t header[3];
+		if (!file.read(magic, 4) || std::string(magic, 4) != Magic) return 0;
+		if (!file.read(reinterpret_cast< char * >(header), sizeof(header))) return 0;
+		if (header[1] != key.size()) return 0;
+		//the file must be exactly as long as the header says (so a cut-off or garbled file isn't handed to the driver):
+		std::streamoff header_bytes = file.tellg();
+		file.seekg(0, std::ios::end);
+		if (file.tellg() - header_bytes != std::streamoff(header[1]) + std::streamoff(header[2])) return 0;
+		file.seekg(header_bytes);
+		std::string stored_key(header[1], '\0');
+		if (!file.read(&stored_key[0], stored_key.size()) || stored_key != key) return 0;
+		std::vector< char > binary(header[2]);
+		if (!file.read(binary.data(), binary.size())) return 0;
+
+		GLuint program = glCreateProgram();
+		ProgramBinary(program, GLenum(header[0]), binary.data(), GLsizei(binary.size()));
+		GLint link_status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+		if (link_status != GL_TRUE) {
+			//(e.g., the driver was updated in a way its version string doesn't show; the program will be compiled and saved again)
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	//save a freshly linked program to the cache:
+	void save(std::string const &key, GLuint program) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+		std::vector< char > binary(length);
+		GLenum format = 0;
+		GLsizei written = 0;
+		GetProgramBinary(program, length, &written, &format, binary.data());
+		if (written <= 0) return;
+
+		//write to a temporary file and rename it into place, so a crash (or another copy of the game
+		// starting at the same time) never sees a half-written cache file:
+		std::string path = filename(key);
+		std::string temp_path = path + ".tmp";
+		{
+			std::ofstream file(temp_path, std::ios::binary);
+			uint32_t header[3] = { uint32_t(format), uint32_t(key.size()), uint32_t(written) };
+			file.write(Magic, 4);
+			file.write(reinterpret_cast< char const * >(header), sizeof(header));
+			file.write(key.data(), key.size());
+			file.write(binary.data(), written);
+			file.close();
+			if (!file) {
+				std::cerr << "NOTE: failed to write program cache file '" << temp_path << "'." << std::endl;
+				std::remove(temp_path.c_str());
+				return;
+			}
+		}
+		bool renamed = (std::rename(temp_path.c_str(), path.c_str()) == 0);
+		if (!renamed) {
+			//(on Windows, rename won't replace an existing file, so clear away the stale one and try again)
+			std::remove(path.c_str());
+			renamed = (std::rename(temp_path.c_str(), path.c_str()) == 0);
+		}
+		if (!renamed) {
+			std::cerr << "NOTE: failed to move program cache file into place at '" << path << "'." << std::endl;
+			std::remove(temp_path.c_str());
+		}
+	}
+};
+
+static ProgramBinaryCache program_binary_cache;
+
+void gl_program_cache(std::string const &directory) {
+	program_binary_cache.directory = directory;
+}
+
+//----------------------------------------------------------------
+
+//----------------------------------------------------------------
+//Parallel compilation.
+//KHR_parallel_shader_compile (or the identical ARB_parallel_shader_compile) isn't in GL.hpp either:
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+struct ParallelShaderCompile {
+	bool checked = false; //looked for the extension yet?
+	bool supported = false;
+
+	//can GL_COMPLETION_STATUS_KHR be queried?
+	bool enabled() {
+		if (!checked) {
+			checked = true;
+			void (APIENTRY *MaxShaderCompilerThreads)(GLuint count) = nullptr;
+			if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+				MaxShaderCompilerThreads = (decltype(MaxShaderCompilerThreads))SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+			} else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+				MaxShaderCompilerThreads = (decltype(MaxShaderCompilerThreads))SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+			}
+			if (MaxShaderCompilerThreads) {
+				//(some drivers start with no compiler threads at all; 0xffffffff lets the driver pick how many)
+				MaxShaderCompilerThreads(0xffffffff);
+				supported = true;
+			}
+		}
+		return supported;
+	}
+};
+
+static ParallelShaderCompile parallel_shader_compile;
+
+//----------------------------------------------------------------
+
+static void check_shader(GLuint shader) {
 	GLint compile_status = GL_FALSE;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
 	if (compile_status != GL_TRUE) {
@@ -21,30 +211,11 @@ static GLuint gl_compile_shader(GLenum type, std::string const &source) {
 		GLsizei length = 0;
 		glGetShaderInfoLog(shader, GLint(info_log.size()), &length, &info_log[0]);
 		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
 		throw std::runtime_error("Failed to compile shader.");
 	}
-	return shader;
 }
 
-GLuint gl_compile_program(
-	std::string const &vertex_shader_source,
-	std::string const &fragment_shader_source
-	) {
-
-	GLuint vertex_shader = gl_compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
-	GLuint fragment_shader = gl_compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
-
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-
-	//shaders are reference counted so this makes sure they are freed after program is deleted:
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
-
-	//link the shader program and throw errors if linking fails:
-	glLinkProgram(program);
+static void check_program(GLuint program) {
 	GLint link_status = GL_FALSE;
 	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
 	if (link_status != GL_TRUE) {
@@ -57,6 +228,118 @@ GLuint gl_compile_program(
 		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
 		throw std::runtime_error("failed to link program");
 	}
+}
+
+//(doesn't check the result -- asking for GL_COMPILE_STATUS would wait for the compiler)
+static GLuint gl_start_shader(GLenum type, std::string const &source) {
+	GLuint shader = glCreateShader(type);
+	GLchar const *str = source.c_str();
+	GLint length = GLint(source.size());
+	glShaderSource(shader, 1, &str, &length);
+	glCompileShader(shader);
+	return shader;
+}
+
+GLProgramBatch::~GLProgramBatch() {
+	for (auto &p : programs) {
+		if (p.vertex_shader) glDeleteShader(p.vertex_shader);
+		if (p.fragment_shader) glDeleteShader(p.fragment_shader);
+		if (p.program) glDeleteProgram(p.program);
+	}
+}
+
+size_t GLProgramBatch::add(std::string const &vertex_shader_source, std::string const &fragment_shader_source) {
+	programs.emplace_back();
+	Program &p = programs.back();
+
+	//if this exact program has been linked before (by this driver), just load it:
+	if (program_binary_cache.enabled()) {
+		TRACE_SCOPE("load cached program");
+		p.cache_key = program_binary_cache.key(vertex_shader_source, fragment_shader_source);
+		p.program = program_binary_cache.load(p.cache_key);
+		if (p.program) return programs.size() - 1;
+	}
+
+	TRACE_SCOPE("compile program");
+
+	parallel_shader_compile.enabled(); //(turns on the driver's compiler threads the first time)
+
+	p.vertex_shader = gl_start_shader(GL_VERTEX_SHADER, vertex_shader_source);
+	p.fragment_shader = gl_start_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+
+	p.program = glCreateProgram();
+	glAttachShader(p.program, p.vertex_shader);
+	glAttachShader(p.program, p.fragment_shader);
+
+	//(ask the driver to keep what it needs to hand the linked program back)
+	if (!p.cache_key.empty()) {
+		program_binary_cache.ProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	//linking is allowed before the shaders are done compiling; it just fails if they didn't compile:
+	glLinkProgram(p.program);
+
+	return programs.size() - 1;
+}
+
+bool GLProgramBatch::ready(size_t index) const {
+	Program const &p = programs.at(index);
+	if (!p.program || !p.vertex_shader || !parallel_shader_compile.enabled()) return true;
+	//(the program isn't complete until its shaders are)
+	GLint completion_status = GL_TRUE;
+	glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &completion_status);
+	return completion_status == GL_TRUE;
+}
+
+bool GLProgramBatch::ready() const {
+	for (size_t index = 0; index < programs.size(); ++index) {
+		if (!ready(index)) return false;
+	}
+	return true;
+}
+
+GLuint GLProgramBatch::take(size_t index) {
+	Program &p = programs.at(index);
+	if (!p.program) throw std::runtime_error("Program " + std::to_string(index) + " was already taken from the batch.");
+
+	GLuint program = p.program;
+	p.program = 0;
+	if (!p.vertex_shader) return program; //(from the cache, so already checked)
+
+	TRACE_SCOPE("finish program");
+
+	//shaders are reference counted, so deleting them here frees them when the program is deleted:
+	// (and, if something throws below, right away)
+	GLuint vertex_shader = p.vertex_shader;
+	GLuint fragment_shader = p.fragment_shader;
+	p.vertex_shader = p.fragment_shader = 0;
+
+	try {
+		//throw errors if compiling or linking failed:
+		check_shader(vertex_shader);
+		check_shader(fragment_shader);
+		check_program(program);
+	} catch (...) {
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		glDeleteProgram(program);
+		throw;
+	}
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	if (!p.cache_key.empty()) {
+		program_binary_cache.save(p.cache_key, program);
+	}
 
 	return program;
 }
+
+GLuint gl_compile_program(
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source
+	) {
+	//a batch of one:
+	GLProgramBatch batch;
+	return batch.take(batch.add(vertex_shader_source, fragment_shader_source));
+}
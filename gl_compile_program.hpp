@@ -3,9 +3,46 @@
 #include "GL.hpp"
 
 #include <string>
+#include <vector>
 
 //compiles+links an OpenGL shader program from source.
 // throws on compilation error.
+// (if the program cache is on and has this program, loads the driver's binary instead of compiling)
 GLuint gl_compile_program(
 	std::string const &vertex_shader_source,
 	std::string const &fragment_shader_source);
+
+//compiles+links many OpenGL shader programs at once:
+// add() hands each program's shaders to the driver without waiting for them, so the driver can work on
+// them all (in parallel, on its own threads, if it has KHR_parallel_shader_compile) while the caller gets
+// on with other loading; take() then waits for a program (if it must) and checks it for errors.
+struct GLProgramBatch {
+	GLProgramBatch() = default;
+	GLProgramBatch(GLProgramBatch const &) = delete;
+	~GLProgramBatch(); //deletes any programs that were never taken
+
+	//start compiling+linking a program; returns its index (for ready() and take()):
+	size_t add(std::string const &vertex_shader_source, std::string const &fragment_shader_source);
+
+	//has program 'index' (or, with no index, every program) finished compiling+linking?
+	// never waits; without KHR_parallel_shader_compile there is no way to ask, so always says yes.
+	bool ready(size_t index) const;
+	bool ready() const;
+
+	//wait for program 'index' and hand it over (the caller deletes it); throws on compilation error, like gl_compile_program:
+	GLuint take(size_t index);
+
+	//----- internals -----
+	struct Program {
+		GLuint program = 0; //0 once taken
+		GLuint vertex_shader = 0, fragment_shader = 0; //0 if the program came from the cache
+		std::string cache_key; //empty if not caching
+	};
+	std::vector< Program > programs;
+};
+
+//keep linked programs (from glGetProgramBinary) in 'directory' -- which must exist, and should end
+// with a slash -- so later runs can skip compiling and linking (empty: don't cache, the default).
+// Cached programs are keyed on their source and the GL vendor, renderer, and version strings, and
+// are only used if the driver supports program binaries (GL 4.1 or ARB_get_program_binary).
+void gl_program_cache(std::string const &directory);
@@ -1,45 +1,61 @@
 #include "load_save_png.hpp"
+#include "MappedFile.hpp"
 
 #include <png.h>
+#include <zlib.h>
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <memory>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
+//SavePngOptions passes these through to libpng as-is:
+static_assert(SavePngOptions::FilterNone == PNG_FILTER_NONE && SavePngOptions::FilterSub == PNG_FILTER_SUB
+	&& SavePngOptions::FilterUp == PNG_FILTER_UP && SavePngOptions::FilterAvg == PNG_FILTER_AVG
+	&& SavePngOptions::FilterPaeth == PNG_FILTER_PAETH && SavePngOptions::FilterAll == PNG_ALL_FILTERS,
+	"SavePngOptions filters should match libpng's");
+static_assert(SavePngOptions::StrategyDefault == Z_DEFAULT_STRATEGY && SavePngOptions::StrategyFiltered == Z_FILTERED
+	&& SavePngOptions::StrategyHuffmanOnly == Z_HUFFMAN_ONLY && SavePngOptions::StrategyRLE == Z_RLE
+	&& SavePngOptions::StrategyFixed == Z_FIXED,
+	"SavePngOptions strategies should match zlib's");
 
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
 	assert(size);
 
-	std::ifstream file(filename.c_str(), std::ios::binary);
-	if (!file) {
-		throw std::runtime_error("Failed to open PNG image file '" + filename + "'.");
+	//(decode straight from the file's pages into 'data', rather than through an ifstream)
+	std::unique_ptr< MappedFile > file;
+	try {
+		file.reset(new MappedFile(filename));
+	} catch (std::runtime_error &e) {
+		throw std::runtime_error("Failed to open PNG image file '" + filename + "': " + e.what());
 	}
-	if (!load_png(file, &size->x, &size->y, data, origin)) {
-		throw std::runtime_error("Failed to read PNG image from '" + filename + "'.");
+	try {
+		load_png(file->data, file->size, size, data, origin);
+	} catch (std::runtime_error &e) {
+		throw std::runtime_error("Failed to read PNG image from '" + filename + "': " + e.what());
 	}
 }
 
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options) {
 	std::ofstream file(filename.c_str(), std::ios::binary);
-	save_png(file, size.x, size.y, data, origin);
+	save_png(file, size, data, origin, options);
 }
 
 
-static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png_ptr));
-	assert(from);
-	if (!from->read(reinterpret_cast< char * >(data), length)) {
-		png_error(png_ptr, "Error reading.");
-	}
-}
-
 static void user_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
 	std::ostream *to = reinterpret_cast< std::ostream * >(png_get_io_ptr(png_ptr));
 	assert(to);
@@ -57,41 +73,69 @@ static void user_flush_data(png_structp png_ptr) {
 }
 
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
-	assert(data);
-	uint32_t local_width, local_height;
-	if (width == nullptr) width = &local_width;
-	if (height == nullptr) height = &local_height;
-	*width = *height = 0;
-	data->clear();
-	//..... load file ......
-	//Load a png file, as per the libpng docs:
-	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
-
-	png_set_read_fn(png, &from, user_read_data);
-
-	if (!png) {
-		LOG_ERROR("  cannot alloc read struct.");
-		return false;
-	}
-	png_infop info = png_create_info_struct(png);
-	if (!info) {
-		LOG_ERROR("  cannot alloc info struct.");
-		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
-		return false;
-	}
-	png_bytep *row_pointers = NULL;
+//----------------------------------------------------------------
+//Decoding from memory:
+
+struct MemoryReader {
+	uint8_t const *at;
+	size_t remaining;
+};
+
+static void memory_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
+	MemoryReader *from = reinterpret_cast< MemoryReader * >(png_get_io_ptr(png_ptr));
+	assert(from);
+	if (length > from->remaining) {
+		png_error(png_ptr, "Unexpected end of data.");
+	}
+	std::memcpy(data, from->at, length);
+	from->at += length;
+	from->remaining -= length;
+}
+
+//destroys the read struct however decode_png exits (a longjmp from libpng, or a callback throwing):
+struct PngReadGuard {
+	png_structp png = nullptr;
+	png_infop info = nullptr;
+	~PngReadGuard() {
+		if (png) png_destroy_read_struct(&png, info ? &info : NULL, NULL);
+	}
+};
+
+//decode the PNG in memory, calling 'on_size' once the size is known and then, for each row y
+// (counting from the top), decoding it into 'row(y)' and calling 'on_row(y)' (if given).
+//If 'rows_persist' (the rows stay valid through the whole decode), interlaced images are assembled in place;
+// otherwise they're decoded into a temporary image first.
+static void decode_png(void const *png_data, size_t png_bytes,
+	std::function< void(glm::uvec2 const &) > const &on_size,
+	std::function< glm::u8vec4 *(uint32_t) > const &row,
+	std::function< void(uint32_t) > const &on_row,
+	bool rows_persist) {
+
+	MemoryReader reader;
+	reader.at = reinterpret_cast< uint8_t const * >(png_data);
+	reader.remaining = png_bytes;
+	if (png_bytes < 8 || png_sig_cmp(reader.at, 0, 8) != 0) {
+		throw std::runtime_error("Not PNG data.");
+	}
+
+	PngReadGuard guard;
+	vector< glm::u8vec4 > whole; //(for interlaced images)
+	guard.png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
+	if (!guard.png) throw std::runtime_error("Cannot alloc PNG read struct.");
+	guard.info = png_create_info_struct(guard.png);
+	if (!guard.info) throw std::runtime_error("Cannot alloc PNG info struct.");
+	png_structp png = guard.png;
+	png_infop info = guard.info;
+
+	png_set_read_fn(png, &reader, memory_read_data);
+
 	if (setjmp(png_jmpbuf(png))) {
-		LOG_ERROR("  png interal error.");
-		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
-		return false;
+		throw std::runtime_error("Error decoding PNG data.");
 	}
-	//not needed with custom read/write functions: png_init_io(png, NULL);
+
 	png_read_info(png, info);
-	unsigned int w = png_get_image_width(png, info);
-	unsigned int h = png_get_image_height(png, info);
+	glm::uvec2 size(png_get_image_width(png, info), png_get_image_height(png, info));
+	//convert whatever is in the file to 8-bit RGBA:
 	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE)
 		png_set_palette_to_rgb(png);
 	if (png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY || png_get_color_type(png, info) == PNG_COLOR_TYPE_GRAY_ALPHA)
@@ -102,33 +146,101 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 		png_set_packing(png);
 	if (png_get_bit_depth(png,info) == 16)
 		png_set_strip_16(png);
-	//Ok, should be 32-bit RGBA now.
+	int passes = png_set_interlace_handling(png);
 
 	png_read_update_info(png, info);
-	size_t rowbytes = png_get_rowbytes(png, info);
 	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
+	assert(png_get_rowbytes(png, info) == size.x*sizeof(uint32_t));
 
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
-	for (unsigned int r = 0; r < h; ++r) {
-		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
-		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+	//(callbacks may throw; that's fine, the guard cleans up)
+	on_size(size);
+	if (!row) return;
+
+	if (passes == 1 || rows_persist) {
+		for (int pass = 0; pass < passes; ++pass) {
+			for (uint32_t y = 0; y < size.y; ++y) {
+				png_read_row(png, reinterpret_cast< png_bytep >(row(y)), NULL);
+				if (pass + 1 == passes && on_row) on_row(y);
+			}
+		}
+	} else {
+		whole.resize(size_t(size.x) * size.y);
+		for (int pass = 0; pass < passes; ++pass) {
+			for (uint32_t y = 0; y < size.y; ++y) {
+				png_read_row(png, reinterpret_cast< png_bytep >(&whole[size_t(y) * size.x]), NULL);
+			}
+		}
+		for (uint32_t y = 0; y < size.y; ++y) {
+			glm::u8vec4 *to = row(y);
+			std::memcpy(to, &whole[size_t(y) * size.x], size.x * sizeof(glm::u8vec4));
+			if (on_row) on_row(y);
+		}
+	}
+	png_read_end(png, NULL);
+}
+
+glm::uvec2 png_size(void const *png, size_t png_bytes) {
+	glm::uvec2 size(0);
+	decode_png(png, png_bytes, [&size](glm::uvec2 const &size_) { size = size_; }, nullptr, nullptr, false);
+	return size;
+}
+
+void load_png(void const *png, size_t png_bytes, glm::uvec2 const &size, glm::u8vec4 *pixels, OriginLocation origin, size_t row_stride) {
+	if (row_stride == 0) row_stride = size.x * sizeof(glm::u8vec4);
+	assert(row_stride >= size.x * sizeof(glm::u8vec4));
+	decode_png(png, png_bytes, [&size](glm::uvec2 const &actual) {
+		if (actual != size) {
+			throw std::runtime_error("PNG is " + std::to_string(actual.x) + "x" + std::to_string(actual.y)
+				+ ", not the expected " + std::to_string(size.x) + "x" + std::to_string(size.y) + ".");
 		}
+	}, [&](uint32_t y) {
+		size_t stored = (origin == UpperLeftOrigin ? y : size.y - 1 - y);
+		return reinterpret_cast< glm::u8vec4 * >(reinterpret_cast< uint8_t * >(pixels) + stored * row_stride);
+	}, nullptr, true);
+}
+
+void load_png(void const *png, size_t png_bytes, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
+	assert(data);
+	try {
+		decode_png(png, png_bytes, [&](glm::uvec2 const &actual) {
+			*size = actual;
+			data->resize(size_t(size->x) * size->y);
+		}, [&](uint32_t y) {
+			size_t stored = (origin == UpperLeftOrigin ? y : size->y - 1 - y);
+			return &(*data)[stored * size->x];
+		}, nullptr, true);
+	} catch (...) {
+		data->clear();
+		throw;
 	}
-	png_read_image(png, row_pointers);
-	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
+}
 
-	*width = w;
-	*height = h;
-	return true;
+void load_png_rows(void const *png, size_t png_bytes,
+	std::function< void(glm::uvec2 const &size) > const &on_size,
+	std::function< void(uint32_t y, glm::u8vec4 const *row) > const &on_row) {
+	vector< glm::u8vec4 > buffer; //one row
+	decode_png(png, png_bytes, [&](glm::uvec2 const &size) {
+		buffer.resize(size.x);
+		if (on_size) on_size(size);
+	}, [&buffer](uint32_t) {
+		return buffer.data();
+	}, [&](uint32_t y) {
+		if (on_row) on_row(y, buffer.data());
+	}, false);
 }
 
 
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin) {
+static void save_png_strips(std::ostream &to, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options);
+
+void save_png(std::ostream &to, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options) {
+	if (options.threads > 1 && size.x > 0 && size.y > 1) {
+		save_png_strips(to, size, data, origin, options);
+		return;
+	}
+
+	unsigned int width = size.x;
+	unsigned int height = size.y;
 //After the libpng example.c
 	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 
@@ -155,6 +267,14 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8
 	//Not needed with custom read/write functions: png_init_io(png_ptr, fp);
 	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+	if (options.compression_level >= 0) {
+		png_set_compression_level(png_ptr, options.compression_level);
+	}
+	png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, options.filters);
+	if (options.strategy != SavePngOptions::StrategyLibpng) {
+		png_set_compression_strategy(png_ptr, options.strategy);
+	}
+
 	png_write_info(png_ptr, info_ptr);
 	//png_set_swap_alpha(png_ptr) // might need?
 	vector< png_bytep > row_pointers(height);
@@ -173,3 +293,327 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8
 
 	return;
 }
+
+//----------------------------------------------------------------
+//Strip-parallel encoder (SavePngOptions::threads > 1), after pigz:
+// the image is split into horizontal strips; each strip is filtered and deflated on its own thread into
+// raw deflate blocks that end with a sync flush (so they end on a byte boundary and can simply be
+// concatenated), and the strips' adler32 checksums are combined into the one that ends the zlib stream.
+// Each strip's compressor is primed with the (filtered) end of the strip above, so matches can still
+// reach back across the seams and the result is nearly as small as a single-threaded encode.
+// libpng only does the chunk framing for one big zlib stream, so the chunks are written here directly.
+
+//PNG filter types (PNG spec, section 9.2); bit (0x08 << type) is the matching SavePngOptions::Filter:
+enum : uint8_t { TypeNone = 0, TypeSub = 1, TypeUp = 2, TypeAvg = 3, TypePaeth = 4 };
+
+static uint8_t paeth_predictor(uint8_t a, uint8_t b, uint8_t c) {
+	int p = int(a) + int(b) - int(c);
+	int pa = std::abs(p - int(a));
+	int pb = std::abs(p - int(b));
+	int pc = std::abs(p - int(c));
+	if (pa <= pb && pa <= pc) return a;
+	else if (pb <= pc) return b;
+	else return c;
+}
+
+//filter 'row' (with 'prev' the unfiltered row above, all zeros for the first row) into 'out', type byte first:
+static void filter_row(uint8_t type, uint8_t const *row, uint8_t const *prev, size_t bytes, uint8_t *out) {
+	const size_t bpp = 4; //bytes per pixel
+	out[0] = type;
+	out += 1;
+	if (type == TypeNone) {
+		std::memcpy(out, row, bytes);
+	} else if (type == TypeUp) {
+		for (size_t i = 0; i < bytes; ++i) out[i] = uint8_t(row[i] - prev[i]);
+	} else {
+		//(the first pixel has nothing to its left, so do it separately to keep the branches out of the loops)
+		size_t first = std::min(bpp, bytes);
+		if (type == TypeSub) {
+			for (size_t i = 0; i < first; ++i) out[i] = row[i];
+			for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - row[i-bpp]);
+		} else if (type == TypeAvg) {
+			for (size_t i = 0; i < first; ++i) out[i] = uint8_t(row[i] - prev[i] / 2);
+			for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - ((int(row[i-bpp]) + int(prev[i])) / 2));
+		} else { assert(type == TypePaeth);
+			for (size_t i = 0; i < first; ++i) out[i] = uint8_t(row[i] - prev[i]); //(paeth_predictor(0, b, 0) == b)
+			for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - paeth_predictor(row[i-bpp], prev[i], prev[i-bpp]));
+		}
+	}
+}
+
+//filter with whichever allowed filter gives the smallest sum of (signed) residuals, as libpng does:
+static void filter_row_best(uint8_t filters, uint8_t const *row, uint8_t const *prev, size_t bytes, uint8_t *out, vector< uint8_t > *scratch) {
+	uint32_t allowed = 0;
+	uint8_t only = TypeNone;
+	for (uint8_t type = TypeNone; type <= TypePaeth; ++type) {
+		if (filters & (0x08 << type)) {
+			allowed += 1;
+			only = type;
+		}
+	}
+	if (allowed <= 1) {
+		filter_row(only, row, prev, bytes, out);
+		return;
+	}
+
+	scratch->resize(1 + bytes);
+	uint64_t best_sum = ~uint64_t(0);
+	for (uint8_t type = TypeNone; type <= TypePaeth; ++type) {
+		if (!(filters & (0x08 << type))) continue;
+		filter_row(type, row, prev, bytes, scratch->data());
+		uint64_t sum = 0;
+		for (size_t i = 1; i <= bytes && sum < best_sum; ++i) { //(stop once it can't win)
+			sum += uint64_t(std::abs(int(int8_t((*scratch)[i]))));
+		}
+		if (sum < best_sum) {
+			best_sum = sum;
+			std::memcpy(out, scratch->data(), 1 + bytes);
+		}
+	}
+}
+
+//Worker threads shared by every save_png with threads > 1 (started when first needed and kept until exit),
+// so encoding one image after another doesn't start and join a batch of threads -- twice -- for every image.
+//Each call queues a batch of jobs and works on it too, so it finishes even if every worker is busy with others.
+struct PngWorkers {
+	struct Batch {
+		std::function< void(uint32_t) > const *job = nullptr;
+		uint32_t count = 0;
+		uint32_t next = 0; //next job to hand out
+		uint32_t unfinished = 0; //jobs not done yet
+	};
+
+	std::mutex mutex; //protects everything below
+	std::condition_variable wake_worker; //a batch was queued (or stopping was set)
+	std::condition_variable job_done;
+	std::deque< Batch * > batches; //batches with jobs left to hand out
+	bool stopping = false;
+	std::vector< std::thread > threads;
+
+	~PngWorkers() {
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			stopping = true;
+		}
+		wake_worker.notify_all();
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	//take the next job from 'batch' (call with the mutex held; returns false if it has none left):
+	bool take(Batch &batch, uint32_t *index) {
+		if (batch.next == batch.count) return false;
+		*index = batch.next++;
+		if (batch.next == batch.count) {
+			batches.erase(std::find(batches.begin(), batches.end(), &batch));
+		}
+		return true;
+	}
+
+	//run 'job(0) ... job(count-1)' on up to 'count' threads (one of them the calling thread):
+	void run(uint32_t count, std::function< void(uint32_t) > const &job) {
+		Batch batch;
+		batch.job = &job;
+		batch.count = count;
+		batch.unfinished = count;
+		{
+			std::lock_guard< std::mutex > lock(mutex);
+			while (threads.size() + 1 < count) {
+				threads.emplace_back(&PngWorkers::work, this);
+			}
+			if (count > 0) batches.emplace_back(&batch);
+		}
+		wake_worker.notify_all();
+
+		std::unique_lock< std::mutex > lock(mutex);
+		uint32_t index;
+		while (take(batch, &index)) {
+			lock.unlock();
+			job(index);
+			lock.lock();
+			batch.unfinished -= 1;
+		}
+		job_done.wait(lock, [&batch](){ return batch.unfinished == 0; });
+	}
+
+	void work() {
+		std::unique_lock< std::mutex > lock(mutex);
+		while (true) {
+			wake_worker.wait(lock, [this](){ return stopping || !batches.empty(); });
+			if (stopping) break;
+			Batch &batch = *batches.front();
+			uint32_t index;
+			take(batch, &index);
+			lock.unlock();
+			(*batch.job)(index);
+			lock.lock();
+			batch.unfinished -= 1;
+			if (batch.unfinished == 0) job_done.notify_all();
+		}
+	}
+};
+
+static void run_parallel(uint32_t count, std::function< void(uint32_t) > const &job) {
+	static PngWorkers workers;
+	workers.run(count, job);
+}
+
+static void write_u32_be(uint8_t *at, uint32_t value) {
+	at[0] = uint8_t(value >> 24);
+	at[1] = uint8_t(value >> 16);
+	at[2] = uint8_t(value >> 8);
+	at[3] = uint8_t(value);
+}
+
+static bool write_chunk(std::ostream &to, char const *type, uint8_t const *data, size_t length) {
+	assert(length < 0x80000000UL); //(PNG chunks are at most 2^31-1 bytes)
+	uint8_t header[8];
+	write_u32_be(header, uint32_t(length));
+	std::memcpy(header + 4, type, 4);
+	uLong crc = crc32(0, header + 4, 4);
+	if (length) crc = crc32(crc, data, uInt(length)); //(with a null 'data', crc32 would restart instead)
+	uint8_t footer[4];
+	write_u32_be(footer, uint32_t(crc));
+	to.write(reinterpret_cast< char const * >(header), 8);
+	to.write(reinterpret_cast< char const * >(data), length);
+	to.write(reinterpret_cast< char const * >(footer), 4);
+	return bool(to);
+}
+
+static void save_png_strips(std::ostream &to, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options) {
+	uint32_t width = size.x;
+	uint32_t height = size.y;
+	size_t row_bytes = size_t(width) * 4;
+	uint32_t strip_count = std::min(options.threads, height);
+
+	//same choices libpng would make:
+	int level = (options.compression_level >= 0 ? options.compression_level : Z_DEFAULT_COMPRESSION);
+	int strategy = options.strategy;
+	if (options.strategy == SavePngOptions::StrategyLibpng) {
+		strategy = (options.filters == SavePngOptions::FilterNone ? Z_DEFAULT_STRATEGY : Z_FILTERED);
+	}
+
+	//image row y, counting from the top:
+	auto image_row = [&](uint32_t y) {
+		uint32_t stored = (origin == UpperLeftOrigin ? y : height - 1 - y);
+		return reinterpret_cast< uint8_t const * >(data + size_t(stored) * width);
+	};
+
+	struct Strip {
+		uint32_t begin = 0, end = 0; //rows [begin,end)
+		vector< uint8_t > filtered; //(1 + row_bytes) per row
+		vector< uint8_t > deflated;
+		uLong adler = 1;
+		bool failed = false;
+	};
+	vector< Strip > strips(strip_count);
+	for (uint32_t s = 0; s < strip_count; ++s) {
+		strips[s].begin = uint32_t(uint64_t(height) * s / strip_count);
+		strips[s].end = uint32_t(uint64_t(height) * (s + 1) / strip_count);
+	}
+
+	//filter (needs only the image, so every strip at once):
+	run_parallel(strip_count, [&](uint32_t s) {
+		Strip &strip = strips[s];
+		strip.filtered.resize((strip.end - strip.begin) * (1 + row_bytes));
+		vector< uint8_t > zeros(strip.begin == 0 ? row_bytes : 0, 0);
+		vector< uint8_t > scratch;
+		for (uint32_t y = strip.begin; y < strip.end; ++y) {
+			uint8_t const *prev = (y == 0 ? zeros.data() : image_row(y - 1));
+			filter_row_best(options.filters, image_row(y), prev, row_bytes, &strip.filtered[(y - strip.begin) * (1 + row_bytes)], &scratch);
+		}
+		strip.adler = adler32(1, strip.filtered.data(), uInt(strip.filtered.size()));
+	});
+
+	//deflate (needs the strip above for the dictionary, so after all the filtering):
+	run_parallel(strip_count, [&](uint32_t s) {
+		Strip &strip = strips[s];
+		bool last = (s + 1 == strip_count);
+
+		z_stream z;
+		std::memset(&z, 0, sizeof(z));
+		//(negative window bits: raw deflate data, the zlib header and checksum are written below)
+		if (deflateInit2(&z, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+			strip.failed = true;
+			return;
+		}
+		if (s > 0) {
+			vector< uint8_t > const &above = strips[s-1].filtered;
+			size_t dictionary = std::min< size_t >(above.size(), 32768);
+			deflateSetDictionary(&z, above.data() + above.size() - dictionary, uInt(dictionary));
+		}
+
+		//the first strip starts with the zlib header, the last one ends with the checksum:
+		size_t prefix = (s == 0 ? 2 : 0);
+		strip.deflated.resize(prefix + deflateBound(&z, uLong(strip.filtered.size())) + 16);
+		z.next_in = strip.filtered.data();
+		z.avail_in = uInt(strip.filtered.size());
+		z.next_out = strip.deflated.data() + prefix;
+		z.avail_out = uInt(strip.deflated.size() - prefix);
+		int flush = (last ? Z_FINISH : Z_SYNC_FLUSH);
+		while (true) {
+			int ret = deflate(&z, flush);
+			if (ret == Z_STREAM_END) break;
+			if (ret != Z_OK && ret != Z_BUF_ERROR) {
+				strip.failed = true;
+				break;
+			}
+			if (!last && z.avail_in == 0 && z.avail_out != 0) break; //(sync flush done)
+			if (z.avail_out == 0) { //(deflateBound should make this impossible, but just in case)
+				size_t used = strip.deflated.size();
+				strip.deflated.resize(used * 2);
+				z.next_out = strip.deflated.data() + used;
+				z.avail_out = uInt(strip.deflated.size() - used);
+			}
+		}
+		strip.deflated.resize(strip.deflated.size() - z.avail_out);
+		deflateEnd(&z);
+	});
+
+	for (auto const &strip : strips) {
+		if (strip.failed) {
+			LOG_ERROR("Error compressing png.");
+			return;
+		}
+	}
+
+	//zlib header: deflate with a 32k window, compression level hint, check bits so the header is a multiple of 31:
+	uint8_t cmf = 0x78;
+	uint8_t flevel = (level == Z_DEFAULT_COMPRESSION || level == 6 ? 2 : level < 2 ? 0 : level < 6 ? 1 : 3);
+	uint8_t flg = uint8_t(flevel << 6);
+	flg = uint8_t(flg + (31 - (cmf * 256 + flg) % 31) % 31);
+	strips.front().deflated[0] = cmf;
+	strips.front().deflated[1] = flg;
+
+	//zlib trailer: adler32 of all the filtered data:
+	uLong adler = strips[0].adler;
+	for (uint32_t s = 1; s < strip_count; ++s) {
+		adler = adler32_combine(adler, strips[s].adler, z_off_t(strips[s].filtered.size()));
+	}
+	uint8_t trailer[4];
+	write_u32_be(trailer, uint32_t(adler));
+	strips.back().deflated.insert(strips.back().deflated.end(), trailer, trailer + 4);
+
+	//write PNG signature, IHDR, one IDAT per strip, IEND:
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	to.write(reinterpret_cast< char const * >(signature), 8);
+
+	uint8_t ihdr[13];
+	write_u32_be(ihdr + 0, width);
+	write_u32_be(ihdr + 4, height);
+	ihdr[8] = 8; //bit depth
+	ihdr[9] = 6; //color type: RGBA
+	ihdr[10] = 0; //compression method: deflate
+	ihdr[11] = 0; //filter method: adaptive
+	ihdr[12] = 0; //interlace method: none
+	bool ok = write_chunk(to, "IHDR", ihdr, 13);
+
+	for (auto const &strip : strips) {
+		ok = ok && write_chunk(to, "IDAT", strip.deflated.data(), strip.deflated.size());
+	}
+	ok = ok && write_chunk(to, "IEND", nullptr, 0);
+	if (!ok) {
+		LOG_ERROR("Error writing png.");
+	}
+}
@@ -2,6 +2,8 @@
 
 #include <glm/glm.hpp>
 
+#include <functional>
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -15,6 +17,69 @@ enum OriginLocation {
 	UpperLeftOrigin,
 };
 
+//How hard save_png works at compressing. The defaults are libpng's; for big, flat game frames,
+// SavePngOptions::fast() is several times faster for a slightly larger file (see png_bench.cpp):
+struct SavePngOptions {
+	//zlib level, from 0 (store uncompressed) to 9 (smallest and slowest), or -1 for zlib's default (6):
+	int compression_level = -1;
+
+	//row filters libpng may pick from (it tries each one per row, so fewer is faster):
+	// (same values as libpng's PNG_FILTER_*)
+	enum Filter : uint8_t {
+		FilterNone = 0x08,
+		FilterSub = 0x10,
+		FilterUp = 0x20,
+		FilterAvg = 0x40,
+		FilterPaeth = 0x80,
+		FilterAll = 0xf8,
+	};
+	uint8_t filters = FilterAll;
+
+	//zlib strategy (same values as zlib's Z_*):
+	enum Strategy : int8_t {
+		StrategyLibpng = -1, //libpng's choice (filtered if filters are on, otherwise default)
+		StrategyDefault = 0,
+		StrategyFiltered = 1,
+		StrategyHuffmanOnly = 2,
+		StrategyRLE = 3,
+		StrategyFixed = 4,
+	};
+	Strategy strategy = StrategyLibpng;
+
+	//threads to encode with; more than one splits the image into horizontal strips that are
+	// compressed in parallel and stitched into one stream (a few hundred bytes bigger per strip):
+	uint32_t threads = 1;
+
+	//good settings for saving lots of frames quickly:
+	// (on game frames, level 1 with just the 'up' filter is about 3x faster than the defaults, for files ~2x bigger;
+	//  StrategyRLE was no faster and twice as big again)
+	static SavePngOptions fast() {
+		SavePngOptions options;
+		options.compression_level = 1;
+		options.filters = FilterUp;
+		return options;
+	}
+};
+
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options = SavePngOptions());
+//save to a stream instead of a file:
+void save_png(std::ostream &to, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, SavePngOptions const &options = SavePngOptions());
+
+//Decoding PNG data that's already in memory (e.g. a MappedFile), straight into memory the caller owns
+// (e.g. a mapped pixel unpack buffer), so big images aren't copied through a stream or held twice.
+//(these throw on error, too)
+
+//size of the image in PNG data (only reads the header):
+glm::uvec2 png_size(void const *png, size_t png_bytes);
+//decode to 'pixels', which must have room for 'size' (== png_size()) pixels, with rows 'row_stride' bytes apart (0: packed):
+void load_png(void const *png, size_t png_bytes, glm::uvec2 const &size, glm::u8vec4 *pixels, OriginLocation origin, size_t row_stride = 0);
+//decode to a vector sized to fit, reading the header only once:
+void load_png(void const *png, size_t png_bytes, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+//decode one row at a time: 'on_size' is called first, then 'on_row' for every row, top to bottom
+// ('y' counts from the top; 'row' is only valid during the call). Only one row is held at a time,
+// except for interlaced images, which have to be decoded whole first:
+void load_png_rows(void const *png, size_t png_bytes,
+	std::function< void(glm::uvec2 const &size) > const &on_size,
+	std::function< void(uint32_t y, glm::u8vec4 const *row) > const &on_row);
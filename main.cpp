@@ -7,8 +7,22 @@
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//for caching compiled shader programs:
+#include "gl_compile_program.hpp"
+
 //for screenshots:
-#include "load_save_png.hpp"
+#include "FrameCapture.hpp"
+
+//for loading textures in the background:
+#include "TextureLoader.hpp"
+
+//for recording and replaying input:
+#include "InputLog.hpp"
+
+//for timing the phases of the main loop:
+#include "Profiler.hpp"
+#include "ProfilerOverlay.hpp"
+#include "Trace.hpp"
 
 //Includes for libSDL:
 #include <SDL.h>
@@ -19,6 +33,167 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+
+//Framebuffer with a single color renderbuffer, for drawing when there is no visible window:
+// (bound as the current framebuffer when created)
+struct OffscreenFramebuffer {
+	OffscreenFramebuffer(glm::uvec2 const &size) {
+		glGenRenderbuffers(1, &color_rb);
+		glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &fb);
+		glBindFramebuffer(GL_FRAMEBUFFER, fb);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("Offscreen framebuffer is incomplete.");
+		}
+		glViewport(0, 0, size.x, size.y);
+	}
+	~OffscreenFramebuffer() {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &fb);
+		glDeleteRenderbuffers(1, &color_rb);
+	}
+	GLuint color_rb = 0;
+	GLuint fb = 0;
+};
+
+//print mean/p50/p99/max of a list of per-frame times (sorts the list):
+static void report_ms(char const *name, std::vector< double > &ms) {
+	if (ms.empty()) return;
+	double total = 0.0;
+	for (double m : ms) total += m;
+	std::sort(ms.begin(), ms.end());
+	std::cout << "  " << name << " ms/frame: mean " << (total / ms.size())
+	          << ", p50 " << ms[ms.size() / 2]
+	          << ", p99 " << ms[std::min(ms.size() - 1, ms.size() * 99 / 100)]
+	          << ", max " << ms.back() << std::endl;
+}
+
+//milliseconds between two GL_TIMESTAMP queries (waits for the second one):
+// (waiting right away is fine for the benchmarks below, since nothing else is going on)
+static double gl_elapsed_ms(GLuint const queries[2]) {
+	GLuint64 before = 0, after = 0;
+	glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &after);
+	glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &before);
+	return (after - before) * 1e-6;
+}
+
+//Offscreen benchmark: draw 'frames' frames of 'mode' into a framebuffer object of 'size' pixels,
+// timing each draw() on the CPU and (with GL_TIMESTAMP queries) on the GPU.
+//The game is stepped a fixed 1/60s per frame with both paddles ai-controlled, so runs are comparable.
+static void run_offscreen(KillerPongMode &mode, uint32_t frames, glm::uvec2 size) {
+	std::cout << "Offscreen benchmark on '" << (char const *)glGetString(GL_RENDERER) << "', "
+	          << frames << " frames at " << size.x << "x" << size.y << "." << std::endl;
+
+	OffscreenFramebuffer target(size);
+
+	//timestamps before and after each draw (GL_TIME_ELAPSED can't be used, since draw() uses it inside):
+	GLuint queries[2] = {0, 0};
+	glGenQueries(2, queries);
+
+	mode.game.left_ai = true;
+
+	std::vector< double > cpu_ms; cpu_ms.reserve(frames);
+	std::vector< double > gl_ms; gl_ms.reserve(frames);
+
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		//four fixed steps per frame is 1/60s of game time:
+		for (uint32_t step = 0; step < 4; ++step) {
+			mode.update(Mode::Tick);
+		}
+		mode.set_interpolation(1.0f);
+
+		auto before = std::chrono::high_resolution_clock::now();
+		glQueryCounter(queries[0], GL_TIMESTAMP);
+		mode.draw(size);
+		glQueryCounter(queries[1], GL_TIMESTAMP);
+		auto after = std::chrono::high_resolution_clock::now();
+
+		cpu_ms.emplace_back(std::chrono::duration< double, std::milli >(after - before).count());
+		gl_ms.emplace_back(gl_elapsed_ms(queries));
+	}
+
+	glDeleteQueries(2, queries);
+
+	report_ms("CPU", cpu_ms);
+	report_ms("GL ", gl_ms);
+	std::cout << "  (" << mode.game.balls.size() << " balls on screen at the end)" << std::endl;
+}
+
+//Replay: feed a recorded input log to Mode::current, stepping and drawing (offscreen) exactly as
+// the main loop did when it was recorded, and time update() and draw() for every frame.
+static void run_replay(InputReplay &replay) {
+	std::unique_ptr< OffscreenFramebuffer > target;
+	glm::uvec2 window_size = glm::uvec2(0);
+	glm::uvec2 drawable_size = glm::uvec2(0);
+	float accumulator = 0.0f;
+	uint32_t frames = 0;
+
+	GLuint queries[2] = {0, 0};
+	glGenQueries(2, queries);
+
+	std::vector< double > update_ms;
+	std::vector< double > draw_ms;
+	std::vector< double > gl_ms;
+
+	InputReplay::Record record;
+	while (Mode::current && replay.next(&record)) {
+		if (record.type == InputReplay::Record::Size) {
+			window_size = record.window_size;
+			drawable_size = record.drawable_size;
+			target.reset(); //(free the old framebuffer before making the new one)
+			target.reset(new OffscreenFramebuffer(drawable_size));
+		} else if (record.type == InputReplay::Record::Event) {
+			//same dispatch as the main loop (minus the screenshot key):
+			if (Mode::current->handle_event(record.event, window_size)) {
+				// mode handled it; great
+			} else if (record.event.type == SDL_QUIT) {
+				Mode::set_current(nullptr);
+			}
+		} else if (record.type == InputReplay::Record::Frame) {
+			frames += 1;
+
+			//same fixed-step loop as the main loop:
+			auto before_update = std::chrono::high_resolution_clock::now();
+			accumulator += record.elapsed;
+			while (accumulator >= Mode::Tick) {
+				accumulator -= Mode::Tick;
+				Mode::current->update(Mode::Tick);
+				if (!Mode::current) break;
+			}
+			if (!Mode::current) break;
+			Mode::current->set_interpolation(accumulator / Mode::Tick);
+			auto after_update = std::chrono::high_resolution_clock::now();
+			update_ms.emplace_back(std::chrono::duration< double, std::milli >(after_update - before_update).count());
+
+			if (!target) continue; //(no size recorded yet, so nothing to draw to)
+
+			auto before_draw = std::chrono::high_resolution_clock::now();
+			glQueryCounter(queries[0], GL_TIMESTAMP);
+			Mode::current->draw(drawable_size);
+			glQueryCounter(queries[1], GL_TIMESTAMP);
+			auto after_draw = std::chrono::high_resolution_clock::now();
+
+			draw_ms.emplace_back(std::chrono::duration< double, std::milli >(after_draw - before_draw).count());
+			gl_ms.emplace_back(gl_elapsed_ms(queries));
+		}
+	}
+
+	glDeleteQueries(2, queries);
+	target.reset();
+
+	std::cout << "Replayed " << frames << " frames on '" << (char const *)glGetString(GL_RENDERER) << "'." << std::endl;
+	report_ms("update", update_ms);
+	report_ms("draw  ", draw_ms);
+	report_ms("GL    ", gl_ms);
+}
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -26,6 +201,119 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------ parse command line ------------
+	//  pong [--seed S] [--record LOG] [--profile-csv CSV] [--trace JSON] [--capture-every N [--capture-prefix P] [--capture-raw]] [--upload-budget MS] [--load-texture PNG ...] [--no-program-cache] [--offscreen FRAMES [--size WxH]] [--replay LOG]
+	//--seed picks the random ball directions and ai moves, so the same seed (and input) plays out the same way.
+	//--record writes every event and frame time to LOG; --replay plays LOG back in a hidden window, prints timings and exits.
+	//--profile-csv writes the main loop's per-phase frame times to CSV as they happen (F3 shows them while playing).
+	//--trace writes a timeline of every frame for chrome://tracing or ui.perfetto.dev.
+	//--capture-every saves every Nth frame as P000000.png, P000001.png, ... (or .rgba, raw pixels, with --capture-raw);
+	// frames are skipped (and counted) if the encoders fall behind.
+	//--upload-budget limits the time spent uploading textures each frame (default 2ms); --load-texture loads PNG that way
+	// (mostly for trying out the budget -- watch "texture upload" with --trace).
+	//--no-program-cache compiles every shader program from source, rather than loading the driver's binaries saved by earlier runs.
+	//--offscreen draws FRAMES frames into a hidden framebuffer, prints timings and exits (for benchmarking).
+	// On a machine without a display or GPU, run it with Mesa's software renderer, e.g.:
+	//  SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 dist/pong --offscreen 1000
+	uint64_t seed = 0;
+	std::string record_filename;
+	std::string replay_filename;
+	std::string profile_csv_filename;
+	std::string trace_filename;
+	uint32_t capture_every = 0;
+	std::string capture_prefix = "capture-";
+	bool capture_raw = false;
+	float upload_budget_ms = 2.0f;
+	std::vector< std::string > load_texture_filenames;
+	bool program_cache = true;
+	uint32_t offscreen_frames = 0;
+	glm::uvec2 offscreen_size = glm::uvec2(640, 480);
+
+	auto usage = [&]() {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--seed S] [--record LOG] [--profile-csv CSV] [--trace JSON] [--capture-every N [--capture-prefix P] [--capture-raw]] [--upload-budget MS] [--load-texture PNG ...] [--no-program-cache] [--offscreen FRAMES [--size WxH]] [--replay LOG]" << std::endl;
+	};
+
+	//(missing or malformed values throw)
+	std::string arg;
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			arg = argv[argi];
+			auto next = [&]() -> std::string {
+				if (argi + 1 >= argc) throw std::runtime_error("Expecting a value after '" + arg + "'.");
+				argi += 1;
+				return argv[argi];
+			};
+			if (arg == "--seed") {
+				seed = std::stoull(next());
+			} else if (arg == "--record") {
+				record_filename = next();
+			} else if (arg == "--replay") {
+				replay_filename = next();
+			} else if (arg == "--profile-csv") {
+				profile_csv_filename = next();
+			} else if (arg == "--trace") {
+				trace_filename = next();
+			} else if (arg == "--capture-every") {
+				capture_every = uint32_t(std::stoul(next()));
+			} else if (arg == "--capture-prefix") {
+				capture_prefix = next();
+			} else if (arg == "--capture-raw") {
+				capture_raw = true;
+			} else if (arg == "--upload-budget") {
+				upload_budget_ms = std::stof(next());
+			} else if (arg == "--load-texture") {
+				load_texture_filenames.emplace_back(next());
+			} else if (arg == "--no-program-cache") {
+				program_cache = false;
+			} else if (arg == "--offscreen") {
+				offscreen_frames = uint32_t(std::stoul(next()));
+			} else if (arg == "--size") {
+				std::string size = next();
+				size_t x = size.find('x');
+				if (x == std::string::npos) throw std::runtime_error("Expecting a size like 640x480, got '" + size + "'.");
+				offscreen_size = glm::uvec2(std::stoul(size.substr(0, x)), std::stoul(size.substr(x + 1)));
+			} else {
+				usage();
+				return 1;
+			}
+		}
+	} catch (std::logic_error const &) {
+		//(std::stoul and friends throw invalid_argument or out_of_range)
+		std::cerr << "Can't read the value after '" << arg << "'." << std::endl;
+		usage();
+		return 1;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		usage();
+		return 1;
+	}
+
+	//open the files named on the command line (these throw if they can't):
+	std::unique_ptr< InputReplay > replay;
+	std::unique_ptr< InputRecorder > recorder;
+	try {
+		//replays start from the recorded seed:
+		if (!replay_filename.empty()) {
+			replay.reset(new InputReplay(replay_filename));
+			seed = replay->seed;
+		}
+
+		if (!record_filename.empty()) {
+			recorder.reset(new InputRecorder(record_filename, seed));
+		}
+
+		if (!trace_filename.empty()) {
+			trace.start(trace_filename);
+		}
+
+		if (!profile_csv_filename.empty()) {
+			profiler.start_csv(profile_csv_filename);
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -46,6 +334,7 @@ int main(int argc, char **argv) {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
 	//create window:
+	// (when benchmarking offscreen or replaying, the window is only there to hold the context, so it is never shown)
 	SDL_Window *window = SDL_CreateWindow(
 		"Killer Pong",
 		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
@@ -53,6 +342,7 @@ int main(int argc, char **argv) {
 		SDL_WINDOW_OPENGL
 		| SDL_WINDOW_RESIZABLE //uncomment to allow resizing
 		| SDL_WINDOW_ALLOW_HIGHDPI //uncomment for full resolution on high-DPI screens
+		| (offscreen_frames || replay ? uint32_t(SDL_WINDOW_HIDDEN) : 0U)
 	);
 
 	//prevent exceedingly tiny windows when resizing:
@@ -75,6 +365,17 @@ int main(int argc, char **argv) {
 	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
 	init_GL();
 
+	//Keep linked shader programs in the per-user data directory, so later runs start faster:
+	if (program_cache) {
+		char *pref_path = SDL_GetPrefPath("15-466", "killer-pong");
+		if (pref_path) {
+			gl_program_cache(pref_path);
+			SDL_free(pref_path);
+		} else {
+			std::cerr << "NOTE: no place to cache shader programs (" << SDL_GetError() << ")." << std::endl;
+		}
+	}
+
 	//Set VSYNC + Late Swap (prevents crazy FPS):
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
@@ -86,8 +387,27 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
+	//textures decode on worker threads and are uploaded in the main loop:
+	for (auto const &filename : load_texture_filenames) {
+		texture_loader.load(filename);
+	}
+
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< KillerPongMode >());
+	std::shared_ptr< KillerPongMode > killer_pong = std::make_shared< KillerPongMode >();
+	killer_pong->game.rng = Xoshiro128(seed);
+	Mode::set_current(killer_pong);
+
+	//------------ offscreen benchmark or replay (instead of the main loop) ------------
+	//(these time every frame, so get all the textures in first)
+	if (offscreen_frames || replay) texture_loader.finish();
+	if (offscreen_frames) {
+		run_offscreen(*killer_pong, offscreen_frames, offscreen_size);
+		Mode::set_current(nullptr);
+	} else if (replay) {
+		run_replay(*replay);
+		Mode::set_current(nullptr);
+	}
+	killer_pong.reset();
 
 	//------------ main loop ------------
 
@@ -103,15 +423,40 @@ int main(int argc, char **argv) {
 		SDL_GL_GetDrawableSize(window, &w, &h);
 		drawable_size = glm::uvec2(w, h);
 		glViewport(0, 0, drawable_size.x, drawable_size.y);
+		if (recorder) recorder->size(window_size, drawable_size);
 	};
 	on_resize();
 
+	//screenshots and --capture-every (freed before the OpenGL context, below):
+	std::unique_ptr< FrameCapture > frame_capture;
+	if (capture_every) {
+		//continuous capture: encode on (almost) every core, with a couple of readbacks in flight besides:
+		uint32_t cores = std::thread::hardware_concurrency(); //(0 if unknown)
+		uint32_t encoders = (cores > 1 ? cores - 1 : 1);
+		frame_capture.reset(new FrameCapture(encoders + 2, encoders));
+		//(trade a little file size for a lot of encoding speed, so the encoders keep up)
+		frame_capture->png_options = SavePngOptions::fast();
+	} else {
+		frame_capture.reset(new FrameCapture());
+		//(screenshots are one-offs, so encode each one on every core)
+		frame_capture->png_options.threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	uint32_t frames_drawn = 0;
+	uint32_t frames_captured = 0;
+	uint32_t frames_dropped = 0; //(because the encoders were behind)
+
+	//per-phase timings, shown with F3:
+	std::unique_ptr< ProfilerOverlay > profiler_overlay;
+	bool show_profiler = false;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
 		{ //(1) process any events that are pending
+			PROFILE_SCOPE(Events);
+			TRACE_SCOPE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -119,6 +464,7 @@ int main(int argc, char **argv) {
 					on_resize();
 				}
 				//handle input:
+				if (recorder && Mode::current) recorder->event(evt);
 				if (Mode::current && Mode::current->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
@@ -126,24 +472,25 @@ int main(int argc, char **argv) {
 					break;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
 					// --- screenshot key ---
+					//(the pixels are read back in the background and saved by frame_capture a few frames from now)
 					std::string filename = "screenshot.png";
 					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
 					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
 					int w,h;
 					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						px.a = 0xff;
+					if (!frame_capture->capture(filename, glm::uvec2(w,h), GL_FRONT)) {
+						std::cerr << "NOTE: still busy with earlier screenshots, skipping this one." << std::endl;
 					}
-					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+					// --- profiler overlay key ---
+					show_profiler = !show_profiler;
 				}
 			}
 			if (!Mode::current) break;
 		}
 
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
+			PROFILE_SCOPE(Update);
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -153,17 +500,86 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			Mode::current->update(elapsed);
+			if (recorder) recorder->frame(elapsed);
+
+			//run as many fixed-size steps as fit in the time that has passed,
+			//carrying the remainder over to the next frame:
+			static float accumulator = 0.0f;
+			accumulator += elapsed;
+			while (accumulator >= Mode::Tick) {
+				accumulator -= Mode::Tick;
+				TRACE_SCOPE("update");
+				Mode::current->update(Mode::Tick);
+				if (!Mode::current) break;
+			}
 			if (!Mode::current) break;
+
+			//let the mode know how far into the next step we are, for drawing:
+			Mode::current->set_interpolation(accumulator / Mode::Tick);
 		}
 
+		//upload textures the loader has finished decoding, within this frame's budget:
+		texture_loader.upload(upload_budget_ms);
+
 		{ //(3) call the current mode's "draw" function to produce output:
-		
+			PROFILE_SCOPE(Draw);
+			TRACE_SCOPE("draw");
 			Mode::current->draw(drawable_size);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		//continuous capture (of the frame just drawn, so before the overlay):
+		if (capture_every && frames_drawn % capture_every == 0) {
+			char number[16];
+			snprintf(number, sizeof(number), "%06u", frames_captured);
+			std::string filename = capture_prefix + number + (capture_raw ? ".rgba" : ".png");
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+			//(if the readbacks are all busy, skip this frame rather than stall the game)
+			if (frame_capture->capture(filename, drawable_size, GL_BACK, capture_raw ? FrameCapture::RawRGBA : FrameCapture::PNG)) {
+				frames_captured += 1;
+			} else {
+				if (frames_dropped == 0) {
+					std::cerr << "NOTE: encoders can't keep up with --capture-every " << capture_every << ", skipping frames." << std::endl;
+				}
+				frames_dropped += 1;
+			}
+		}
+		frames_drawn += 1;
+
+		if (show_profiler) {
+			profiler.update_stats(); //(only sorted while they're on screen)
+			if (!profiler_overlay) profiler_overlay.reset(new ProfilerOverlay());
+			profiler_overlay->draw(profiler, drawable_size);
+		}
+
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			PROFILE_SCOPE(Swap);
+			TRACE_SCOPE("swap");
+			SDL_GL_SwapWindow(window);
+		}
+
+		//save any screenshots whose pixels have arrived:
+		frame_capture->poll();
+
+		profiler.end_frame();
+	}
+
+	if (!profile_csv_filename.empty()) {
+		profiler.stop_csv();
+		std::cout << "Wrote " << profiler.frame_count << " frames of timings to '" << profile_csv_filename << "'." << std::endl;
+	}
+	profiler_overlay.reset();
+	if (frames_captured) {
+		std::cout << "Finishing " << frames_captured << " captured frames (" << drawable_size.x << "x" << drawable_size.y << ")." << std::endl;
+	}
+	if (frames_dropped) {
+		std::cout << "Skipped " << frames_dropped << " frames that were due to be captured (the encoders were busy)." << std::endl;
+	}
+	frame_capture.reset(); //(waits for screenshots to finish saving)
+	texture_loader.clear();
+
+	if (!trace_filename.empty()) {
+		std::cout << "Writing trace to '" << trace_filename << "'." << std::endl;
+		trace.stop();
 	}
 
 
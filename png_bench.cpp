@@ -0,0 +1,125 @@
+//png_bench re-encodes PNG images with a range of SavePngOptions and reports encode speed and file size,
+// to pick settings for screenshots and --capture-every (run it on real frames, e.g. screenshot.png or capture-*.png).
+//
+//Usage:
+//  png-bench [--reps N] [--threads T] [--tile K] [IMAGE.png ...]
+//--threads sets the thread count for the strip-parallel rows (default: one per core).
+//--tile repeats each image K times across and down, to try bigger frames (e.g. 3 turns screenshot.png into 3840x3012).
+
+#include "load_save_png.hpp"
+
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+int main(int argc, char **argv) {
+	//------------ parse command line ------------
+	uint32_t reps = 5; //encodes per setting (the fastest one is reported)
+	uint32_t threads = std::max(1U, std::thread::hardware_concurrency()); //for the strip-parallel settings
+	uint32_t tile = 1; //copies of the image across and down
+	std::vector< std::string > filenames;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		auto next = [&]() -> std::string {
+			if (argi + 1 >= argc) throw std::runtime_error("Expecting a value after '" + arg + "'.");
+			argi += 1;
+			return argv[argi];
+		};
+		if (arg == "--reps") {
+			reps = std::max(1U, uint32_t(std::stoul(next())));
+		} else if (arg == "--threads") {
+			threads = std::max(1U, uint32_t(std::stoul(next())));
+		} else if (arg == "--tile") {
+			tile = std::max(1U, uint32_t(std::stoul(next())));
+		} else if (arg.size() > 0 && arg[0] != '-') {
+			filenames.emplace_back(arg);
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--reps N] [--threads T] [--tile K] [IMAGE.png ...]" << std::endl;
+			return 1;
+		}
+	}
+	if (filenames.empty()) filenames.emplace_back("screenshot.png");
+
+	//------------ settings to compare ------------
+	struct Setting {
+		std::string name;
+		SavePngOptions options;
+	};
+	std::vector< Setting > settings;
+	auto add = [&settings](std::string const &name, int level, uint8_t filters, SavePngOptions::Strategy strategy) {
+		Setting setting;
+		setting.name = name;
+		setting.options.compression_level = level;
+		setting.options.filters = filters;
+		setting.options.strategy = strategy;
+		settings.emplace_back(setting);
+	};
+	add("libpng defaults", -1, SavePngOptions::FilterAll, SavePngOptions::StrategyLibpng);
+	add("level 9", 9, SavePngOptions::FilterAll, SavePngOptions::StrategyLibpng);
+	add("level 1", 1, SavePngOptions::FilterAll, SavePngOptions::StrategyLibpng);
+	settings.emplace_back(Setting{"level 1, up (fast)", SavePngOptions::fast()});
+	add("level 3, up", 3, SavePngOptions::FilterUp, SavePngOptions::StrategyLibpng);
+	add("level 1, up, rle", 1, SavePngOptions::FilterUp, SavePngOptions::StrategyRLE);
+	add("level 1, none, rle", 1, SavePngOptions::FilterNone, SavePngOptions::StrategyRLE);
+	add("level 6, up, rle", 6, SavePngOptions::FilterUp, SavePngOptions::StrategyRLE);
+	add("level 1, up, huffman", 1, SavePngOptions::FilterUp, SavePngOptions::StrategyHuffmanOnly);
+	add("level 0 (stored)", 0, SavePngOptions::FilterNone, SavePngOptions::StrategyDefault);
+	if (threads > 1) { //the same as above, split into strips and encoded in parallel:
+		std::string suffix = ", " + std::to_string(threads) + " threads";
+		Setting defaults;
+		defaults.name = "libpng defaults" + suffix;
+		defaults.options.threads = threads;
+		settings.emplace_back(defaults);
+		Setting fast{"level 1, up (fast)" + suffix, SavePngOptions::fast()};
+		fast.options.threads = threads;
+		settings.emplace_back(fast);
+	}
+
+	//------------ encode ------------
+	for (auto const &filename : filenames) {
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > data;
+		load_png(filename, &size, &data, UpperLeftOrigin);
+		if (tile > 1) {
+			std::vector< glm::u8vec4 > tiled(size_t(size.x) * tile * size.y * tile);
+			for (uint32_t y = 0; y < size.y * tile; ++y) {
+				for (uint32_t x = 0; x < size.x * tile; ++x) {
+					tiled[size_t(y) * size.x * tile + x] = data[size_t(y % size.y) * size.x + (x % size.x)];
+				}
+			}
+			size *= tile;
+			data.swap(tiled);
+		}
+		double raw_bytes = double(data.size()) * sizeof(glm::u8vec4);
+
+		std::cout << filename << " (" << size.x << "x" << size.y << ", " << std::fixed << std::setprecision(1) << (raw_bytes / (1024.0 * 1024.0)) << " MiB of pixels), best of " << reps << ":" << std::endl;
+
+		for (auto const &setting : settings) {
+			double best = 1e30;
+			size_t bytes = 0;
+			for (uint32_t rep = 0; rep < reps; ++rep) {
+				std::ostringstream out;
+				auto before = std::chrono::high_resolution_clock::now();
+				save_png(out, size, data.data(), UpperLeftOrigin, setting.options);
+				auto after = std::chrono::high_resolution_clock::now();
+				best = std::min(best, std::chrono::duration< double >(after - before).count());
+				bytes = out.str().size();
+			}
+			std::cout << "  " << std::left << std::setw(34) << (setting.name + ":") << std::right
+			          << std::setprecision(2) << std::setw(8) << (best * 1000.0) << " ms"
+			          << std::setprecision(1) << std::setw(8) << (raw_bytes / best / (1024.0 * 1024.0)) << " MiB/s"
+			          << std::setw(10) << bytes << " bytes"
+			          << std::setprecision(2) << std::setw(7) << (100.0 * bytes / raw_bytes) << "%" << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+//pong_headless steps KillerPongGame matches as fast as the CPU allows, without a window or OpenGL context.
+// It's meant for balancing and regression runs on machines without a GPU.
+//
+//Usage:
+//  pong-headless [--matches N] [--seed S] [--tick SECONDS] [--max-time SECONDS] [--ball-collisions] [--trace JSON]
+//  pong-headless --bench-speed BALLS [--tick SECONDS]
+//--trace writes a timeline of every update in every match (it's ignored with --bench-speed).
+
+#include "KillerPongGame.hpp"
+#include "Trace.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+//Microbenchmark for the per-ball speed multiplier:
+// compares the original per-ball pow() against KillerPongGame::update_ball_speeds().
+// Ball ages are spread over twice the time it takes to reach the speed cap, so about half the balls are saturated.
+static void bench_speed(uint32_t ball_count, float tick) {
+	typedef KillerPongGame G;
+	float saturation_age = G::ball_speed_inc_interval * std::log(G::ball_speed_max_multiplier) / std::log(1.0f + G::ball_speed_inc_ratio);
+	uint32_t const frames = 200;
+
+	//oldest-first, as the game stores them:
+	std::vector< float > ages(ball_count);
+	for (uint32_t i = 0; i < ball_count; ++i) {
+		ages[i] = 2.0f * saturation_age * (ball_count - i) / float(ball_count);
+	}
+
+	auto report = [&](std::string const &name, double seconds, float checksum) {
+		std::cout << "  " << name << ": " << (seconds * 1e9 / (double(frames) * ball_count)) << " ns/ball/frame"
+		          << " (checksum " << checksum << ")" << std::endl;
+	};
+
+	std::cout << "Speed multiplier update, " << ball_count << " balls x " << frames << " frames of " << tick << "s:" << std::endl;
+
+	{ //before: one pow() per ball per frame
+		std::vector< float > age = ages;
+		std::vector< float > multiplier(ball_count);
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t frame = 0; frame < frames; ++frame) {
+			for (uint32_t i = 0; i < ball_count; ++i) {
+				age[i] += tick;
+				multiplier[i] = std::min(G::ball_speed_max_multiplier, std::pow((1 + G::ball_speed_inc_ratio), (age[i] / G::ball_speed_inc_interval)));
+			}
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		float checksum = 0.0f;
+		for (float m : multiplier) checksum += m;
+		report("pow per ball", std::chrono::duration< double >(after - before).count(), checksum);
+	}
+
+	{ //after: incremental multiplier with saturated prefix
+		KillerPongGame game;
+		for (uint32_t i = 0; i < ball_count; ++i) {
+			game.balls.push_back(glm::vec2(0.0f), glm::vec2(1.0f, 0.0f), 0.0f);
+			game.balls.age[i] = ages[i];
+			game.balls.speed_multiplier[i] = std::min(G::ball_speed_max_multiplier, std::pow((1 + G::ball_speed_inc_ratio), (ages[i] / G::ball_speed_inc_interval)));
+		}
+		game.update_ball_speeds(0.0f); //(establishes the saturated prefix)
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t frame = 0; frame < frames; ++frame) {
+			game.update_ball_speeds(tick);
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		float checksum = 0.0f;
+		for (float m : game.balls.speed_multiplier) checksum += m;
+		report("incremental", std::chrono::duration< double >(after - before).count(), checksum);
+	}
+}
+
+int main(int argc, char **argv) {
+	//------------ parse command line ------------
+	uint32_t matches = 1000; //number of matches to simulate
+	uint64_t seed = 0; //match i is seeded with seed + i, so the same seed always gives the same results
+	float tick = 1.0f / 240.0f; //simulation step (in seconds; same as Mode::Tick in the windowed game)
+	float max_time = 600.0f; //matches running longer than this (in simulated seconds) are called a draw
+	bool ball_collisions = false; //if set, balls bounce off each other
+	std::string trace_filename; //if set, write a timeline of every update (for chrome://tracing or ui.perfetto.dev)
+	uint32_t bench_speed_balls = 0; //if non-zero, run the speed multiplier benchmark instead of matches
+
+	auto usage = [&]() {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--matches N] [--seed S] [--tick SECONDS] [--max-time SECONDS] [--ball-collisions] [--trace JSON]\n"
+		          << "\t" << argv[0] << " --bench-speed BALLS [--tick SECONDS]" << std::endl;
+	};
+
+	//(missing or malformed values throw)
+	std::string arg;
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			arg = argv[argi];
+			auto next = [&]() -> std::string {
+				if (argi + 1 >= argc) throw std::runtime_error("Expecting a value after '" + arg + "'.");
+				argi += 1;
+				return argv[argi];
+			};
+			if (arg == "--matches") {
+				matches = uint32_t(std::stoul(next()));
+			} else if (arg == "--seed") {
+				seed = std::stoull(next());
+			} else if (arg == "--tick") {
+				tick = std::stof(next());
+			} else if (arg == "--max-time") {
+				max_time = std::stof(next());
+			} else if (arg == "--ball-collisions") {
+				ball_collisions = true;
+			} else if (arg == "--trace") {
+				trace_filename = next();
+			} else if (arg == "--bench-speed") {
+				bench_speed_balls = uint32_t(std::stoul(next()));
+			} else {
+				usage();
+				return 1;
+			}
+		}
+	} catch (std::logic_error const &) {
+		//(std::stoul and friends throw invalid_argument or out_of_range)
+		std::cerr << "Can't read the value after '" << arg << "'." << std::endl;
+		usage();
+		return 1;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		usage();
+		return 1;
+	}
+
+	if (!(tick > 0.0f)) {
+		std::cerr << "Tick must be positive." << std::endl;
+		return 1;
+	}
+
+	if (bench_speed_balls) {
+		bench_speed(bench_speed_balls, tick);
+		return 0;
+	}
+
+	if (!trace_filename.empty()) {
+		try {
+			trace.start(trace_filename);
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	//------------ simulate ------------
+	uint32_t left_wins = 0;
+	uint32_t right_wins = 0;
+	uint32_t draws = 0;
+	double total_time = 0.0; //simulated seconds, summed over all matches
+	uint64_t total_steps = 0;
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t match = 0; match < matches; ++match) {
+		KillerPongGame game;
+		game.rng = Xoshiro128(seed + match);
+		//nobody is holding a mouse, so both paddles are ai-controlled:
+		game.left_ai = true;
+		game.ball_collisions = ball_collisions;
+
+		while (!game.is_complete() && game.time < max_time) {
+			TRACE_SCOPE("update");
+			game.update(tick);
+			total_steps += 1;
+		}
+
+		total_time += game.time;
+		if (!game.is_complete()) draws += 1;
+		else if (game.right_hp <= 0) left_wins += 1;
+		else right_wins += 1;
+	}
+
+	auto after = std::chrono::high_resolution_clock::now();
+	trace.stop();
+	double wall = std::chrono::duration< double >(after - before).count();
+
+	//------------ report ------------
+	std::cout << "Simulated " << matches << " matches (" << total_steps << " steps of " << tick << "s) in " << wall << "s wall time." << std::endl;
+	std::cout << "  left wins: " << left_wins << ", right wins: " << right_wins << ", draws: " << draws << std::endl;
+	if (matches) {
+		std::cout << "  average match length: " << (total_time / matches) << "s simulated" << std::endl;
+	}
+	if (wall > 0.0) {
+		std::cout << "  " << (matches / wall) << " matches/s, " << (total_steps / wall) << " steps/s" << std::endl;
+	}
+
+	return 0;
+}